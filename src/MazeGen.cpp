@@ -1,1363 +1,5120 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-#include <math.h>
-
-class Stat
-{
-public:
-	Stat() : _sum(0.0), _sqrsum(0.0), _n(0) {}
-	void add(double v)
-	{
-		_sum += v;
-		_sqrsum += v*v;
-		_n++;
-	}
-	double avg() { return _sum / _n; }
-	double stddev() { return sqrt((_sqrsum - (_sum * _sum)/_n)/(_n - 1)); }
-	static double dist(Stat &p, Stat &q)
-	{
-		// https://en.wikipedia.org/wiki/Bhattacharyya_distance
-		double avg_p = p.avg();
-		double std2_p = p.stddev();
-		std2_p = std2_p * std2_p;
-		double avg_q = q.avg();
-		double std2_q = q.stddev();
-		std2_q = std2_q * std2_q;
-		
-		return ( log((std2_p/std2_q + std2_q/std2_p + 2)/4)
-		       + (avg_p - avg_q)*(avg_p - avg_q)/(std2_p + std2_q)
-		       )/4;
-	}
-private:
-	double _sum;
-	double _sqrsum;
-	int _n;
-};
-
-
-
-class Maze
-{
-private:
-	enum state { s_passage, s_wall, s_hard_wall };
-public:
-	Maze(int w, int h) : _w(w), _h(h), _depth(0)
-	{
-		_vert = new state[(w-1)*h];
-		for (int i = 0; i < (w-1)*h; i++)
-			_vert[i] = s_wall;
-		_horz = new state[w*(h-1)];
-		for (int i = 0; i < w*(h-1); i++)
-			_horz[i] = s_wall;
-	}
-	~Maze()
-	{
-		delete[] _vert;
-		delete[] _horz;
-	}
-	state &right(int i, int j) { /*printf("right(%d,%d)\n", i, j);*/return _vert[_h*i + j]; }
-	state &left(int i, int j) { /*printf("left(%d,%d)\n", i, j);*/return _vert[_h*(i-1) + j]; }
-	state &bottom(int i, int j) { /*printf("bottom(%d,%d)\n", i, j);*/return _horz[i + _w*j]; }
-	state &top(int i, int j) { /*printf("top(%d,%d)\n", i, j);*/return _horz[i + _w*(j-1)]; }
-
-	void generateRecursive()
-	{
-		bool *visited = new bool[_w*_h];
-		for (int i = 0; i < _w*_h; i++)
-			visited[i] = false;
-		_recurse(0, 0, visited);
-		delete[] visited;
-	}
-	void generateSplit()
-	{
-		_split(0, 0, _w, _h);
-	}
-	enum frac_type { frac_regular, frac_reverse, frac_random_orient_no_cross, frac_reverse_random_orient_no_cross, frac_random_orient, frac_all_random };
-	void generateFractal(frac_type type)
-	{
-		generateFractal(_w/2, _h/2, type);
-	}
-	void generateTrees()
-	{
-		for (int i = 0; i < (_w-1)*_h; i++)
-			if (_vert[i] != s_hard_wall)
-				_vert[i] = s_passage;
-		for (int i = 0; i < _w*(_h-1); i++)
-			if (_vert[i] != s_hard_wall)
-				_horz[i] = s_passage;
-		_fix();
-	}
-	void generateDig()
-	{
-		_fix();
-	}
-	void generateWilson()
-	{
-		// https://en.wikipedia.org/wiki/Maze_generation_algorithm#Wilson's_algorithm
-		
-	    // Algorithm assums that all traversals are marked as s_wall.
-	
-		// state is used for recording walking direction from a room (using 0 to 3)
-		// and to record which rooms are included (using 4).
-		int to_go = _w*_h;
-		int* state = new int[_w*_h];
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h; j++)
-			{
-				state[i + _w*j] = 0;
-				for (int d = 0; d < 4; d++)
-					if (_wall(i, j, d) == s_passage)
-					{
-						state[i + _w*j] = 4;
-						to_go--;
-						break;
-					}
-			}
-		if (to_go == _w*_h)
-		{
-			// Mark random room as included
-			state[(rand()%_w) + _w*(rand()%_h)] = 4;
-			to_go--;
-		}
-
-		// While there are still rooms not included
-		while (to_go > 0)
-		{
-			//printf("to go %d: ", to_go);
-			// Pick a random room that is not yet included
-			int s = rand()%to_go;
-			int s_i = -1;
-			int s_j = 0;
-			for (int i = 0; i < _w && s_i == -1; i++)
-				for (int j = 0; j < _h && s_i == -1; j++)
-					if (state[i + _w*j] != 4 && s-- == 0)
-					{
-						s_i = i;
-						s_j = j;
-					}
-			// Perform a random walk from this room until
-			// an included room is found, marking the directions
-			int i = s_i;
-			int j = s_j;
-			//printf("start %d,%d: ", i, j);
-			while (state[i + _w*j] != 4)
-			{
-				int d = rand()%4;
-				if (_wall(i, j, d) != s_hard_wall)
-				{
-					state[i + _w*j] = d;
-					switch(d)
-					{
-						case 0: i++; break;
-						case 1: j++; break;
-						case 2: i--; break;
-						case 3: j--; break;
-					}
-				}
-			}
-			//printf("found\n");
-			// Start from the initial room, following the
-			// marked directions, marking them as included
-			// and making all traversals into a passage 
-			i = s_i;
-			j = s_j;
-			while (state[i + _w*j] != 4)
-			{
-				int d = state[i + _w*j];
-				state[i + _w*j] = 4;
-				switch(d)
-				{
-					case 0: right(i,j) = s_passage;  i++; break;
-					case 1: bottom(i,j) = s_passage; j++; break;
-					case 2: left(i,j) = s_passage;   i--; break;
-					case 3: top(i,j) = s_passage;    j--; break;
-				}
-				to_go--;
-			}
-		}
-		delete state;
-	}
-	void generateRandom()
-	{
-		int nr_all = 0;
-		for (int i = 0; i < (_w-1)*_h; i++)
-			if (_vert[i] != s_hard_wall)
-				nr_all++;
-		for (int i = 0; i < _w*(_h-1); i++)
-			if (_horz[i] != s_hard_wall)
-				nr_all++;
-		int nr_passages = _w * _h - 1;
-		for (int i = 0; i < (_w-1)*_h; i++)
-			if (_vert[i] != s_hard_wall)
-			{
-				_vert[i] = rand() % nr_all < nr_passages ? s_passage : s_wall;
-				nr_all--;
-				if (_vert[i] == s_passage)
-					nr_passages--;
-			}
-		for (int i = 0; i < _w*(_h-1); i++)
-			if (_horz[i] != s_hard_wall)
-			{
-				_horz[i] = rand() % nr_all < nr_passages ? s_passage : s_wall;
-				nr_all--;
-				if (_horz[i] == s_passage)
-					nr_passages--;
-			}
-		_fix();
-	}
-	void generateFractal(int i, int j, frac_type type)
-	{
-		int size = 1;
-		while (   i - size > 0 || i + size < _w-1
-		       || j - size > 0 || j + size < _w-1)
-			size *= 2;
-		_fractal(i, j, size, type, -1);
-	}
-	void print(bool* visited = 0, int ti = -1, int tj = -1)
-	{
-		for (int j = 0; j < _h; j++)
-		{
-			for (int i = 0; i < _w; i++)
-				printf("+%c", _hasWall(i, j, 3) ? (_wall(i, j, 3) == s_wall ? '-' : '=') : ' ');
-			printf("+\n");
-			for (int i = 0; i < _w; i++)
-				printf("%c%c", _hasWall(i, j, 2) ? (_wall(i, j, 2) == s_wall ? ':' : '|') : ' ', i == ti && j == tj ? '*' : visited != 0 && visited[i + _w*j] ? 'x' : ' ');
-			printf("|\n");
-		}
-		for (int i = 0; i < _w; i++)
-			printf("+-");
-		printf("+\n");
-	}
-	void printStats()
-	{
-		int types[16];
-		int one, two_straight, two_turn, three, four;
-		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
-		
-		for (int i = 0; i < 16; i++)
-			if (types[i] > 0)
-			{
-				printf(" ");
-				for (int d = 0; d < 4; d++)
-					if ((i & (1 << d)) != 0)
-						printf("%c", "rblt"[d]);
-				printf(":%d", types[i]);
-			}
-		printf("\n");
-		printf("degree 1: %d\n", one);
-		if (two_straight + two_turn > 0)
-		{
-			printf("degree 2: %d", two_straight + two_turn);
-			if (two_straight > 0)
-				printf(" straight:%d", two_straight);
-			if (two_turn > 0)
-				printf(" turn:%d", two_turn);
-			printf("\n");
-		}
-		printf("degree 3: %d\n", three);
-		if (four > 0)
-			printf("degree 4: %d\n", four);
-	}
-	void printAverageDist()
-	{
-		long int *dist = new long int[_w*_h];
-		for (int i = 0; i < _w*_h; i++)
-			dist[i] = 0;
-		_calcDistances(dist);
-		double sum = 0;
-		double l = 1.0;
-		for (int i = 1; i < _w*_h && dist[i] > 0; i++, l += 1.0)
-		{
-			printf("%ld ", dist[i]);
-			sum += dist[i] * l;
-		}
-		printf(" %lf\n", sum / (_w*_h*(_w*_h-1)/2));
-		delete[] dist;
-	}
-	void calcStats(Stat (&stats)[22])
-	{
-		int types[16];
-		int one, two_straight, two_turn, three, four;
-		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
-		double tot = _w * _h;
-		for (int i = 0; i < 16; i++)
-		{
-			stats[i].add(types[i]/tot);
-			//printf("%d ", types[i]);
-		}
-		stats[16].add(one/tot);
-		stats[17].add(two_straight/tot);
-		stats[18].add(two_turn/tot);
-		stats[19].add(three/tot);
-		stats[20].add(four/tot);
-		long int *dist = new long int[_w*_h];
-		for (int i = 0; i < _w*_h; i++)
-			dist[i] = 0;
-		_calcDistances(dist);
-		double sum = 0;
-		double l = 1.0;
-		for (int i = 1; i < _w*_h && dist[i] > 0; i++, l += 1.0)
-			sum += dist[i] * l;
-		stats[21].add(sum / (_w*_h*(_w*_h-1)/2));
-		//printf("%lf\n", sum / (_w*_h*(_w*_h-1)/2));
-	}
-	long calcDist()
-	{
-		int types[16];
-		int one, two_straight, two_turn, three, four;
-		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
-		long result = 0;
-		int exp = _w * _h / 15;
-		for (int i = 1; i < 15; i++)
-		{
-			int d = (exp - types[i]);
-			if (d < 0)
-				d = -d;
-			printf("%4d", d);
-			result += d*d*d;
-		}
-		return result;
-	}
-	void dump()
-	{
-		for (int j = 0; j < _h; j++)
-		{
-			for (int i = 0; i < _w; i++)
-				printf("%c%c%c%c ", 
-						_hasWall(i, j, 0) ? ' ' : 'r',
-						_hasWall(i, j, 1) ? ' ' : 'b',
-						_hasWall(i, j, 2) ? ' ' : 'l',
-						_hasWall(i, j, 3) ? ' ' : 't');
-			printf("\n");
-		}
-	}
-
-	class iterator
-	{
-	public:
-		iterator(Maze &maze, int i, int j, int d) : _maze(maze), _s_i(i), _s_j(j), _s_d(d), _i(i), _j(j), _d(d), _turn(0), _state(0) { next(); }
-		int i() { return _i; }
-		int j() { return _j; }
-		int d() { return _d; }
-		int turn() { return _turn; }
-		bool more() { return _state != 0; }
-		void next()
-		{
-			switch(_state) {
-				case 0: goto L0;
-				case 1: goto L1;
-				case 2: goto L2;
-				case 3: goto L3;
-				case 4: goto L4;
-			}
-			
-			L0:
-			do
-			{
-				if (!_maze._hasWall(_i, _j, _d-1))
-				{
-					_turn = -1;
-					_state = 1; return; L1:
-					_d = (_d+3)%4;
-					goto Lmove;
-				}
-				else
-				{
-					_turn = 2;
-					_state = 2; return; L2:;
-					if (!_maze._hasWall(_i, _j, _d))
-					{
-						Lmove:
-						switch (_d)
-						{
-							case 0: _i++; break;
-							case 1: _j++; break;
-							case 2: _i--; break;
-							case 3: _j--; break;
-						}
-						_turn = 0;
-						_state = 3; return; L3:;
-					}
-					else
-					{
-						_turn = 1;
-						_state = 4; return; L4:;
-						_d = (_d+1)%4;
-					}
-				}
-			}
-			while (_i != _s_i || _j != _s_j || _d != _s_d);
-			_state = 0;
-		}
-	private:
-		Maze &_maze;
-		int _s_i, _s_j, _s_d;
-		int _i, _j, _d;
-		int _turn;
-		int _state;
-	};
-
-	void removeCrosses()
-	{
-		bool* visited = 0;
-		
-		for (int k = _w + _h - 2; k > 0; k--)
-			for (int i = 0, j = k; i < _w; i++, j--)
-				if (0 <= j && j < _h)
-				{
-					int side = rand()%2 == 0;
-					for (int p = 0; p < 4 && _nrWalls(i, j) == 0; p++, side = 1-side)
-					{
-						//printf("Cross at %d, %d %d\n", i, j, p);
-						int start_s;
-						if (side == 0)
-						{
-							top(i, j) = s_wall;
-							start_s = p < 2 ? 0 : 2;
-						}
-						else
-						{
-							left(i, j) = s_wall;
-							start_s = p < 2 ? 3 : 1;
-						}
-						
-						//printf("%d %d %d %d\n", right(i,j), bottom(i,j), left(i,j), top(i,j));
-						int max_nr_walls = 1;
-						int min_k = k;
-						int best_i = i;
-						int best_j = j;
-						for (iterator it(*this, i - (p < 2 ? 0 : side), j - (p < 2 ? 0 : 1-side), start_s); it.more(); it.next())
-							if (it.turn() == 2)
-							{
-								if (it.i() == 0 && it.j() == 0)
-								{
-									// Reached top left corner: restore wall
-									best_i = i;
-									best_j = j;
-									break;
-								}
-								int this_k = it.i() + it.j();
-								int nr_walls = _nrWalls(i, j);
-								if (this_k < min_k || (this_k == min_k && nr_walls > max_nr_walls))
-								{
-									//printf("  %2d %2d %d %d\n", it.i(), it.j(), it.d(), nr_walls);
-									min_k = this_k;
-									max_nr_walls = nr_walls;
-									best_i = it.i();
-									best_j = it.j();
-								}
-							}
-						bool l = _wall(best_i, best_j, 2) == s_wall;
-						bool t = _wall(best_i, best_j, 3) == s_wall;
-						if (!l && !t)
-						{
-							top(i, j) = s_passage;
-							left(i, j) = s_passage;
-						}
-						else if (l && t ? rand() % 2 == 0 : t)
-							top(best_i, best_j) = s_passage;
-						else
-							left(best_i, best_j) = s_passage;
-					}
-					for (int p = 0; p < 2 && _nrWalls(i, j) == 0; p++, side = 1-side)
-					{
-						if (visited == 0)
-							visited = new bool[_w*_h];
-						for (int i = 0; i < _w*_h; i++)
-							visited[i] = false;
-						int start_s = side == 0 ? 0 : 3, i_s = i, j_s = j;
-						if (side == 0)
-							top(i, j) = s_wall;
-						else
-							left(i, j) = s_wall;
-						for (iterator it(*this, 0, 0, 0); it.more(); it.next())
-							if (it.turn() == 2)
-								visited[it.i() + _w*it.j()] = true;
-						if (visited[i + _w*j])
-						{
-							if (side == 0)
-								j_s--;
-							else
-								i_s--;
-							start_s = (start_s+2)%4;
-						}
-						bool resolved = false;
-						for (iterator it(*this, i_s, j_s, start_s); it.more() && !resolved; it.next())
-							if (it.turn() == 2 && it.i() != i && it.j() != j)
-							{
-								for (int d = 0; d < 4 && !resolved; d++)
-									if (   _wall(it.i(), it.j(), d) == s_wall
-										&& visited[     (it.i() + (d == 0 ? 1 : d == 2 ? -1 : 0))
-										           + _w*(it.j() + (d == 1 ? 1 : d == 3 ? -1 : 0))])
-									{
-										_wall(it.i(), it.j(), d) = s_passage;
-										resolved = true;
-									}
-							}
-						if (!resolved)
-						{
-							top(i, j) = s_passage;
-							left(i, j) = s_passage;
-						}
-					}
-				}
-		delete[] visited;
-	}
-	
-	bool stampStreched(Maze &pattern)
-	{
-		if (pattern._w > _w || pattern._h > _h)
-			return false;
-
-		for (int i = 0; i < pattern._w-1; i++)
-			for (int j = 0; j < pattern._h; j++)
-				if (pattern.right(i, j) >= s_wall)
-				{
-					int l = ((i+1) * _w)/pattern._w - 1;
-					int t = (j * _h)/pattern._h;
-					int b = ((j+1) * _h)/pattern._h;
-					for (int k = t; k < b; k++)
-						right(l, k) = s_hard_wall;
-				}
-		for (int i = 0; i < pattern._w; i++)
-			for (int j = 0; j < pattern._h-1; j++)
-				if (pattern.bottom(i, j) >= s_wall)
-				{
-					int l = (i * _w)/pattern._w;
-					int r = ((i+1) * _w)/pattern._w;
-					int b = ((j+1) * _h)/pattern._h - 1;
-					for (int k = l; k < r; k++)
-						bottom(k, b) = s_hard_wall;
-				}
-		return true;
-	}
-
-	bool stampAt(Maze &pattern, int x, int y)
-	{
-		if (x < 0 || x + pattern._w > _w || y < 0 || y + pattern._h > _h)
-			return false;
-		for (int i = 0; i < pattern._w-1; i++)
-			for (int j = 0; j < pattern._h; j++)
-				right(x + i, y + j) = pattern.right(i, j) >= s_wall ? s_hard_wall : s_passage;
-		for (int i = 0; i < pattern._w; i++)
-			for (int j = 0; j < pattern._h-1; j++)
-				bottom(x + i, y + j) = pattern.bottom(i, j) >= s_wall ? s_hard_wall : s_passage;
-		return true;
-	}
-
-	bool fillPartial(Maze &maze, double factor)
-	{
-		if (_w != maze._w || _h != maze._h)
-			return false;
-		
-		// Determine the height of each cell
-		int *height = new int[_w*_h];
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h; j++)
-				height[i + _w*j] = _h*_w;
-		bool go = true;
-		int h;
-		for (h = 1; go; h++)
-		{
-			go = false;
-			//for (int j = 0; j < _h; j++)
-			//{
-			//	for (int i = 0; i < _w; i++)
-			//		printf("%4d", height[i + _w*j]);
-			//	printf("\n");
-			//}
-			printf("\n");
-			for (int j = 0; j < _h; j++)
-				for (int i = 0; i < _w; i++)
-					if (height[i + _w*j] >= h)
-					{
-						int open = 0;
-						if (i < _w-1 && maze.right(i, j)  == s_passage && height[(i+1) + _w*j] >= h) open++;
-						if (j < _h-1 && maze.bottom(i, j) == s_passage && height[i + _w*(j+1)] >= h) open++;
-						if (i > 0    && maze.left(i, j)   == s_passage && height[(i-1) + _w*j] >= h) open++;
-						if (j > 0    && maze.top(i, j)    == s_passage && height[i + _w*(j-1)] >= h) open++;
-						if (open == 1)
-						{
-							height[i + _w*j] = h;
-							go = true;
-						}
-					}
-		}
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h; j++)
-				if (height[i + _w*j] > h)
-					height[i + _w*j] = h;
-
-		go = true;
-				for (int h = 1; go; h++)
-		{
-			//for (int j = 0; j < _h; j++)
-			//{
-			//	for (int i = 0; i < _w; i++)
-			//		printf("%3d", height[i + _w*j]);
-			//	printf("\n");
-			//}
-			//printf("\n");
-			go = false;
-			for (int i = 0; i < _w-1; i++)
-				for (int j = 0; j < _h; j++)
-					if (maze.right(i, j) == s_passage)
-					{
-						int &l = height[i + _w*j];
-						int &r = height[(i+1) + _w*j];
-						     if (r < l - 1) { r = l - 1; go = true; }
-						else if (l < r - 1) { l = r - 1; go = true; }
-					}
-			for (int i = 0; i < _w; i++)
-				for (int j = 0; j < _h-1; j++)
-					if (maze.bottom(i, j) == s_passage)
-					{
-						int &t = height[i + _w*j];
-						int &b = height[i + _w*(j+1)];
-						     if (b < t - 1) { b = t - 1; go = true; }
-						else if (t < b - 1) { t = b - 1; go = true; }
-					}
-		}
-		// Determine the heights that should be included
-		int nr_excluded = (double)(_w*_h) * (1 - factor);
-		int nr = 0;
-		for (h = 1; nr < nr_excluded; h++)
-			for (int i = 0; i < _w; i++)
-				for (int j = 0; j < _h; j++)
-					if (height[i + _w*j] == h)
-						nr++;
-		// copy the parts above that height
-		for (int i = 0; i < _w-1; i++)
-			for (int j = 0; j < _h; j++)
-				if (maze.right(i, j) == s_passage && height[i + _w*j] >= h && height[(i+1) + _w*j] >= h)
-					right(i, j) = s_passage;
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h-1; j++)
-				if (maze.bottom(i, j) == s_passage && height[i + _w*j] >= h && height[i + _w*(j+1)] >= h)
-					bottom(i, j) = s_passage;
-
-		delete[] height;
-		return true;
-	}
-
-	bool check()
-	{
-		int count = 0;
-		for (iterator it(*this, 0, 0, 0); it.more(); it.next())
-			if (it.turn() == 0)
-				count++;
-		//printf("%d == %d\n", count, 2*(_w*_h - 1));
-		return count == 2*(_w*_h - 1);
-	}
-	
-	void svg(const char *filename, double wall_width, double hall_width, const char *color, double stroke_width, bool with_border)
-	{
-		FILE *f = fopen(filename, "wt");
-		if (f == 0)
-		{
-			fprintf(stderr, "Cannot open file '%s' for writing\n", filename);
-			return;
-		}
-		fprintf(f, "<svg width=\"%.0f\" height=\"%.0f\" xmlns=\"http://www.w3.org/2000/svg\">\n",
-				(wall_width+hall_width)*(_w+1), (wall_width+hall_width)*(_h+1));
-		if (with_border)
-		{
-			fprintf(f, "<path d=\"M%.2lf %.2lf\n", hall_width/2, hall_width/2);
-			fprintf(f, "L %.2lf %.2lf\n", hall_width/2 + (_w+1)*wall_width + _w*hall_width, hall_width/2);
-			fprintf(f, "L %.2lf %.2lf\n", hall_width/2 + (_w+1)*wall_width + _w*hall_width, hall_width/2 + (_h+1)*wall_width + _h*hall_width);
-			fprintf(f, "L %.2lf %.2lf\n", hall_width/2, hall_width/2 + (_h+1)*wall_width + _h*hall_width);
-			fprintf(f, "Z\" stroke=\"%s\" stroke-width=\"%.2lf\" fill-opacity=\"0.0\"/>\n", color, stroke_width);
-		}
-		// Find first cell with not only walls
-		int i = 0;
-		int j = 0;
-		while (j < _h && _nrWalls(i, j) == 4)
-		{
-			if (++i == _w)
-			{
-				i = 0;
-				j++;
-			}
-		}
-		fprintf(f, "<path d=\"M%.2lf %.2lf\n",
-			(hall_width + wall_width)*(i+1) - hall_width/2,
-			(hall_width + wall_width)*(j+1) - hall_width/2);
-		for (iterator it(*this, i, j, 0); it.more(); it.next())
-		{
-			if (it.turn() == -1) 
-				fprintf(f, "L %.2lf %.2lf\n",
-					 (hall_width + wall_width)*(it.i()+1) + hall_width/2*((it.d() == 0 || it.d() == 3) ? -1 : 1),
-					 (hall_width + wall_width)*(it.j()+1) + hall_width/2*((it.d() == 0 || it.d() == 1) ? -1 : 1));
-			if (it.turn() == 1) 
-				fprintf(f, "L %.2lf %.2lf\n",
-					 (hall_width + wall_width)*(it.i()+1) + hall_width/2*((it.d() == 2 || it.d() == 3) ? -1 : 1),
-					 (hall_width + wall_width)*(it.j()+1) + hall_width/2*((it.d() == 0 || it.d() == 3) ? -1 : 1));
-		}
-		fprintf(f, "\" stroke=\"%s\" stroke-width=\"%.2lf\" fill-opacity=\"0.0\"/></svg>\n", color, stroke_width);
-		fclose(f);
-	}
-private:
-	int _depth;
-	state& _wall(int i, int j, int d)
-	{
-		static state outer_wall;
-		outer_wall = s_hard_wall;
-		switch((d+4)%4)
-		{
-			case 0: return i >= _w-1 ? outer_wall : right(i, j);
-			case 1: return j >= _h-1 ? outer_wall : bottom(i, j);
-			case 2: return i <= 0    ? outer_wall : left(i, j);
-			case 3: return j <= 0    ? outer_wall : top(i, j);
-		}
-		return outer_wall;
-	}
-	bool _hasWall(int i, int j, int d)
-	{
-		return _wall(i, j, d) != s_passage;
-	}
-	int _nrWalls(int i, int j)
-	{
-		int c = 0;
-		for (int d = 0; d < 4; d++)
-			if (_hasWall(i, j, d))
-				c++;
-		return c;
-	}
-	bool _notVisited(int i, int j, bool *visited)
-	{
-		return 0 <= i && i < _w && 0 <= j && j < _h && !visited[i + _w*j];
-	}
-	void _recurse(int i, int j, bool *visited)
-	{
-		//print();
-		//printf("visit %d, %d\n", i, j, i + _w*j);
-		visited[i + _w*j] = true;
-		for (;;)
-		{
-			int c = 0;
-			if (_wall(i, j, 0) != s_hard_wall && _notVisited(i+1, j, visited)) c++;
-			if (_wall(i, j, 1) != s_hard_wall && _notVisited(i, j+1, visited)) c++;
-			if (_wall(i, j, 2) != s_hard_wall && _notVisited(i-1, j, visited)) c++;
-			if (_wall(i, j, 3) != s_hard_wall && _notVisited(i, j-1, visited)) c++;
-			if (c == 0)
-				break;
-			int r = rand() % c;
-			//printf("      %d,%d %d, %d\n", i, j, c, r);
-			if (_wall(i, j, 0) != s_hard_wall && _notVisited(i+1, j, visited) && r-- == 0)
-			{
-				right(i, j) = s_passage;
-				_recurse(i+1, j, visited);
-			}
-			else if (_wall(i, j, 1) != s_hard_wall && _notVisited(i, j+1, visited) && r-- == 0)
-			{
-				bottom(i, j) = s_passage;
-				_recurse(i, j+1, visited);
-			}
-			else if (_wall(i, j, 2) != s_hard_wall && _notVisited(i-1, j, visited) && r-- == 0)
-			{
-				left(i, j) = s_passage;
-				_recurse(i-1, j, visited);
-				
-			}
-			else if (_wall(i, j, 3) != s_hard_wall && _notVisited(i, j-1, visited) && r-- == 0)
-			{
-				top(i, j) = s_passage;
-				_recurse(i, j-1, visited);
-			}
-		}
-	}
-	
-	void _split(int i, int j, int w, int h)
-	{
-		//printf("%*.*ssplit %d %d %d %d\n", _depth, _depth, "", i, j, w, h);
-		_depth++;
-		if (w == 1)
-		{
-			for (int k = 1; k < h; k++)
-				top(i, j+k) = s_passage;
-		}
-		else if (h == 1)
-		{
-			for (int k = 1; k < w; k++)
-				left(i+k, j) = s_passage;
-		}
-		else if (w < h || (w == h && (rand()%2 == 0)))
-		{
-			int h_r = h == 2 ? 1 :
-					  h <= 4 ? 1 + rand()%(h-1) :
-					  h <= 6 ? 2 + rand()%(h-3) :
-							   3 + rand()%(h-5);
-			int o = rand()%w;
-			//printf("h_r = %d, o = %d\n", h_r, o);
-			top(i + o, j + h_r) = s_passage;
-			_split(i, j, w, h_r),
-			_split(i, j+h_r, w, h-h_r);
-		}
-		else
-		{
-			int w_r = w == 2 ? 1 :
-					  w <= 4 ? 1 + rand()%(w-1) :
-					  w <= 6 ? 2 + rand()%(w-3) :
-							   3 + rand()%(w-5);
-			int o = rand()%h;
-			//printf("w_r = %d, o = %d\n", w_r, o);
-			left(i + w_r, j + o) = s_passage;
-			_split(i, j, w_r, h),
-			_split(i+w_r, j, w-w_r , h);
-		}
-		_depth--;
-	}
-
-	void _fractal(int i, int j, int size, frac_type ft, int avoid_corner)
-	{
-		//printf("frac %d %d %d\n", i, j, size);
-		if (   i + size <= 0 || i - size >= _w
-		    || j + size <= 0 || j - size >= _h)
-		    return;
-		
-		int d = -1;
-		if (i <= 0)
-		{
-			if (j > 0 && j < _h)
-				top(_left_range(i, size, ft), j) = s_passage;
-		}
-		else if (i >= _w)
-		{
-			if (j > 0 && j < _h)
-				top(_right_range(i, size, ft), j) = s_passage;
-		}
-		else if (j <= 0)
-		{
-			left(i, _bottom_range(j, size, ft)) = s_passage;
-		}
-		else if (j >= _h)
-		{
-			left(i, _top_range(j, size, ft)) = s_passage;
-		}
-		else
-		{
-			switch (ft)
-			{
-				case frac_regular:
-				case frac_reverse:					d = 1; break;
-				case frac_random_orient_no_cross:   d = (avoid_corner + 3 + rand() % 2) % 4; break;
-				case frac_random_orient:
-				case frac_reverse_random_orient_no_cross:
-				case frac_all_random:				d = rand() % 4; break;
-			}
-			if (d != 0) top(_left_range(i, size, ft), j) = s_passage;
-			if (d != 1) left(i, _bottom_range(j, size, ft)) = s_passage;
-			if (d != 2) top(_right_range(i, size, ft), j) = s_passage;
-			if (d != 3) left(i, _top_range(j, size, ft)) = s_passage;
-		}
-		
-		if (size == 1)
-			return;
-		size /= 2;
-		_fractal(i + size, j - size, size, ft, avoid_corner == 0 ? 0 : (d == 1 || d == 2) ? 2 : -1);
-		_fractal(i + size, j + size, size, ft, avoid_corner == 1 ? 1 : (d == 2 || d == 3) ? 3 : -1);
-		_fractal(i - size, j + size, size, ft, avoid_corner == 2 ? 2 : (d == 3 || d == 0) ? 0 : -1);
-		_fractal(i - size, j - size, size, ft, avoid_corner == 3 ? 3 : (d == 0 || d == 1) ? 1 : -1);
-	}
-	int _min(int a, int b) { return a < b ? a : b; }
-	int _left_range(int i, int size, frac_type ft)
-	{
-		int min = i < 0 ? 0 : i;
-		int max = (i + size < _w ? i + size : _w) - 1;
-		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return max;
-		if (ft != frac_all_random) return min;
-		return min + (min < max ? rand()%(max+1 - min) : 0);
-	}
-	int _right_range(int i, int size, frac_type ft)
-	{
-		int max = (i > _w ? _w : i) - 1;
-		int min = i - size > 0 ? i - size : 0;
-		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return min;
-		if (ft != frac_all_random) return max;
-		return min + (min < max ? rand()%(max+1 - min) : 0);
-	}
-	int _bottom_range(int j, int size, frac_type ft)
-	{
-		int min = j < 0 ? 0 : j;
-		int max = (j + size < _h ? j + size : _h) - 1;
-		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return max;
-		if (ft != frac_all_random) return min;
-		return min + (min < max ? rand()%(max+1 - min) : 0);
-	}
-	int _top_range(int j, int size, frac_type ft)
-	{
-		int max = (j < _h ? j : _h) - 1;
-		int min = j - size < 0 ? 0 : j - size;
-		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return min;
-		if (ft != frac_all_random) return max;
-		return min + (min < max ? rand()%(max+1 - min) : 0);
-	}
-	void _fix()
-	{
-		char *c_vert = new char[(_w-1)*_h];
-		char *c_horz = new char[_w*(_h-1)];
-		
-		for (;;)
-		{
-			for (int i = 0; i < (_w-1)*_h; i++)
-				c_vert[i] = 0;
-			for (int i = 0; i < _w*(_h-1); i++)
-				c_horz[i] = 0;
-				
-			int count = 0;
-			int i = rand()%_w;
-			int j = rand()%_h;
-			int d = rand()%4;
-			for (;;)
-			{
-				if (_nrWalls(i, j) > 0)
-				{
-					while (!_hasWall(i, j, d))
-						d = (d+1)%4;
-					d = (d+1)%4;
-					break;
-				}
-				if (++i == _w)
-				{
-					i = 0;
-					if (++j == _h)
-						j = 0;
-				}
-			}
-			for (iterator it(*this, i, j, d); it.more(); it.next())
-				if (it.turn() == 0)
-				{
-					switch (it.d())
-					{
-						case 0: c_vert[_h*(it.i()-1) + it.j()]++; break;
-						case 1: c_horz[it.i() + _w*(it.j()-1)]++; break;
-						case 2: c_vert[_h*it.i() + it.j()]++; break;
-						case 3: c_horz[it.i() + _w*it.j()]++; break;
-					}
-					count++;
-				}
-				else if (it.turn() == 2)
-				{
-					switch (it.d())
-					{
-						case 0: if (it.j() > 0) c_horz[it.i() + _w*(it.j()-1)]++; break;
-						case 1: if (it.i() < _w-1) c_vert[_h*it.i() + it.j()]++; break;
-						case 2: if (it.j() < _h-1) c_horz[it.i() + _w*it.j()]++; break;
-						case 3: if (it.i() > 0) c_vert[_h*(it.i()-1) + it.j()]++; break;
-					}
-				}
-			if (count == 2*(_w*_h - 1))
-				break;
-			
-			count = 0;
-			for (int i = 0; i < (_w-1)*_h; i++)
-				if (c_vert[i] == 1 && _vert[i] != s_hard_wall)
-					count++;
-			for (int i = 0; i < _w*(_h-1); i++)
-				if (c_horz[i] == 1 && _horz[i] != s_hard_wall)
-					count++;
-			//printf(" %d", count);
-			if (count > 0)
-			{
-				int r = rand() % count;
-				count = 0;
-				for (int i = 0; i < (_w-1)*_h; i++)
-					if (c_vert[i] == 1 && _vert[i] != s_hard_wall)
-					{
-						if (count == r)
-							_vert[i] = (_vert[i] == s_wall) ? s_passage : s_wall;
-						count++;
-					}
-				for (int i = 0; i < _w*(_h-1); i++)
-					if (c_horz[i] == 1 && _horz[i] != s_hard_wall)
-					{
-						if (count == r)
-							_horz[i] = (_horz[i] == s_wall) ? s_passage : s_wall;
-						count++;
-					}
-			}
-		}
-		
-		delete[] c_vert;
-		delete[] c_horz;
-	}
-	class _Cell
-	{
-	public:
-		_Cell() : d(0), nr(1), prev(0) {}
-		int d;
-		long nr;
-		class _Cell *prev;
-	};
-	void _calcStats(int* types, int* one, int* two_straight, int* two_turn, int* three, int* four)
-	{
-		for (int i = 0; i < 16; i++)
-			types[i] = 0;
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h; j++)
-				types[  (_hasWall(i, j, 0) ? 0 : 1)
-				      | (_hasWall(i, j, 1) ? 0 : 2)
-				      | (_hasWall(i, j, 2) ? 0 : 4)
-				      | (_hasWall(i, j, 3) ? 0 : 8)]++;
-		*one = types[1] + types[2] + types[4] + types[8];
-		*two_straight = types[1+4] + types[2 + 8];
-		*two_turn = types[1 + 2] + types[2 + 4] + types[4 + 8] + types[8 + 1];
-		*three = types[1 + 2 + 4] + types[2 + 4 + 8] + types [4 + 8 + 1] + types[8 + 1 + 2];
-		*four = types[1 + 2 + 4 + 8];
-	}
-	void _calcDistances(long *dist)
-	{
-		_Cell *cells = new _Cell[_w*_h];
-		for (int i = 0; i < _w; i++)
-			for (int j = 0; j < _h; j++)
-				cells[i + _w*j].d = 4 - _nrWalls(i, j);
-		_Cell *prev = 0;
-		for (iterator it(*this, 0, 0, 0); it.more(); it.next())
-			if (it.turn() == 0)
-			{
-				_Cell *cell = &cells[it.i() + _w*it.j()];
-				if (cell->d != 0)
-				{
-					int a_l = 1;
-					for (_Cell* a = prev; a != 0; a = a->prev, a_l++)
-					{
-						dist[a_l] += a->nr;
-						int b_l = 1;
-						for (_Cell* b = cell->prev; b != 0; b = b->prev, b_l++)
-							dist[a_l + b_l] += a->nr * b->nr;
-					}
-					_Cell* a = prev;
-					_Cell* b = cell->prev;
-					for (; a != 0 && b != 0; a = a->prev, b = b->prev)
-						a->nr = b->nr = a->nr + b->nr;
-					if (a != 0)
-						cell->prev = prev;
-					prev = (--cell->d == 0) ? cell : 0;
-				}
-			}
-		delete[] cells;
-	}
-	int _w, _h;
-	state *_vert, *_horz;
-};
-
-void dist_kind(Stat* stats, int* vec, int n, const char *name)
-{
-	for (int i = 0; i < n; i++)
-		printf(" %5.2lf(%5.2lf)", 100*stats[vec[i]].avg(), 100*stats[vec[i]].stddev());
-	double max_dist = 0;
-	double sum_dist = 0;
-	for (int i = 0; i < n-1; i++)
-		for (int j = i+1; j < n; j++)
-		{
-			double dist = Stat::dist(stats[vec[i]], stats[vec[j]]);
-			if (dist > max_dist)
-				max_dist = dist;
-			sum_dist += dist;
-		}
-	printf(" %s = %6.3lf %6.3lf", name, max_dist, sum_dist);
-	printf(" %6.3lf |", sum_dist);
-}
-
-bool test_all()
-{
-	bool result = true;
-	srand(time(0));
-	{
-		Maze maze(30, 30);
-		maze.generateRecursive();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateSplit();
-		if (!maze.check()) { fprintf(stderr, "Error: generateSplit failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateSplit failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateTrees();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateDig();
-		if (!maze.check()) { fprintf(stderr, "Error: generateDig failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateDig failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateFractal(Maze::frac_regular);
-		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_regular) failed\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateFractal(Maze::frac_reverse_random_orient_no_cross);
-		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_reverse_random_orient_no_cross) failed\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateFractal(Maze::frac_random_orient_no_cross);
-		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_random_orient_no_cross) failed\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateFractal(Maze::frac_random_orient);
-		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_random_orient) failed\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateFractal(Maze::frac_all_random);
-		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_all_random) failed\n"); result = false; }
-	}
-	{
-		Maze maze(30, 30);
-		maze.generateRandom();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRandom failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRandom failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze(10, 10);
-		maze.generateWilson();
-		if (!maze.check()) { fprintf(stderr, "Error: generateWilson failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateWilson failed after remove crosses\n"); result = false; }
-	}
-	{
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateRecursive();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive with stampStreched failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive with stampStreched failed after removing crosses\n"); result = false; }
-	}
-	{
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateRandom();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRandom with stampStreched failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateRandom with stampStreched failed after removing crosses\n"); return false; }
-	}
-	{
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateWilson();
-		if (!maze.check()) { fprintf(stderr, "Error: generateWilson with stampStreched failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateWilson with stampStreched failed after removing crosses\n"); result = false; }
-	}
-	{
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateTrees();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed after removing crosses\n"); result = false; }
-	}
-	{
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateDig();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed\n"); result = false; }
-		maze.removeCrosses();
-		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed after removing crosses\n"); result = false; }
-	}
-	{
-		Maze maze(5, 5);
-		maze.generateRecursive();
-		Maze maze2(15, 15);
-		maze2.stampAt(maze, 5, 5);
-		maze2.generateWilson();
-		if (!maze2.check()) { fprintf(stderr, "Error: generateWilson with stampAt failed\n"); result = false; }
-	}
-
-	return result;
-}
-
-void statistics()
-{
-	const char *names[] = { "Wil", "Ran", "Dig", "Spl", "Tre", "Rec", "", "", "", "", "" };
-	for (int t = 0; t < 6; t++)
-	{
-		printf("%s ", names[t]);
-		for (int size = 20; size <= 20; size += 10)
-		{
-			Stat stats[22];
-			Stat times;
-			for (int i = 0; i < 500; i++)
-			{
-				Maze maze(size, size);
-				long start = clock();
-				switch(t)
-				{
-					case 0:
-						maze.generateWilson(); break;
-					case 1:
-						maze.generateRandom(); break;
-					case 2:
-						maze.generateDig(); break;
-					case 3:
-						maze.generateSplit(); break;
-					case 4:
-						maze.generateTrees(); break;
-					case 5:
-						maze.generateRecursive(); break;
-					case 6:
-					{
-						Maze maze2(size/5, size/5);
-						maze2.generateRecursive();
-						maze.stampStreched(maze2);
-						maze.generateDig();
-					} break;
-					case 7:
-						maze.generateFractal(Maze::frac_reverse_random_orient_no_cross); break;
-					case 8:
-						maze.generateFractal(Maze::frac_random_orient_no_cross); break;
-					case 9:
-						maze.generateFractal(Maze::frac_random_orient); break;
-					case 10:
-						maze.generateFractal(Maze::frac_all_random); break;
-				}
-				if (!maze.check())
-					printf("Error\n");
-				times.add((clock() - start)/((double)size * size));
-				maze.calcStats(stats);
-			}
-			//printf("%d: ", size);
-			for (int i = 16; i < 21; i++)
-			{
-				printf(" %5.2lf(%5.2lf)", 100*stats[i].avg(), 100*stats[i].stddev());
-			}
-			printf(" %6.2lf(%5.2lf) #", stats[21].avg(), stats[21].stddev());
-			int ones[4] = { 1, 2, 4, 8 };
-			dist_kind(stats, ones, 4, "ones");
-			int two_corners[4] = { 1+2, 2+4, 4+8, 8+1 };
-			dist_kind(stats, two_corners, 4, "two corners");
-			int two_straight[2] = { 1+4, 2+8 };
-			dist_kind(stats, two_straight, 2, "two straight");
-			int three[4] = { 1+2+4, 2+4+8, 4+8+1, 8+1+2 };
-			dist_kind(stats, three, 4, "three");
-			printf(" %6.2lf(%5.2lf)", times.avg(), times.stddev());
-			printf("\n");
-			//for (int i = 0; i < 4; i++)
-			//	printf(" %5.2lf(%5.2lf)\n", 100*stats[ones[i]].avg(), 100*stats[ones[i]].stddev());
-			//double max_dist = 0;
-			//double sum_dist = 0;
-			//for (int i = 0; i < 3; i++)
-			//	for (int j = i+1; j < 4; j++)
-			//	{
-			//		double dist = Stat::dist(stats[ones[i]], stats[ones[j]]);
-			//		if (dist > max_dist)
-			//			max_dist = dist;
-			//		sum_dist += dist;
-			//	}
-			//printf("ones dist = %lf %lf\n", max_dist, sum_dist);
-		}
-	}
-}
-int main(int argc, char *argv[])
-{
-	if (!test_all())
-	{
-		fprintf(stderr, "Error: Some test failed\n");
-		return 0;
-	}
-	srand(time(0));
-	//statistics();
-	//Maze maze(30, 30);
-	//maze.generateRecursive();
-	//maze.removeCrosses();
-	//maze.generateSplit();
-	//maze.generateFractal(Maze::frac_regular);
-	//maze.generateFractal(Maze::frac_reverse_random_orient_no_cross);
-	//maze.generateFractal(Maze::frac_random_orient_no_cross);
-	//maze.generateFractal(Maze::frac_random_orient);
-	//maze.generateFractal(Maze::frac_all_random);
-	//Maze maze2(6, 6);
-	//maze2.generateRecursive();
-	//maze.stampStreched(maze2);
-	//maze.generateDig();
-	//maze.generateRecursive();
-	//maze.generateTrees();
-	//maze.generateRandom();
-	//maze.print();
-	//maze.printStats();
-	//maze.printAverageDist();
-	//if (!maze.check())
-	//	printf("Incorrect\n");
-	//maze.svg("Maze.svg", 2, 8, "red", 1, true);
-	//maze.dump();
-	Maze maze(5, 5);
-	maze.generateWilson();
-	maze.print();
-	maze.svg("Maze4.svg", 4, 4, "red", 1, false);
-	Maze maze2(15, 15);
-	maze2.stampAt(maze, 5, 5);
-	maze2.print();
-	maze2.generateWilson();
-	maze2.print();
-	maze2.svg("Maze3.svg", 4, 4, "red", 1, false);
-	Maze maze3(25, 25);
-	maze3.stampAt(maze2, 5, 5);
-	maze3.generateWilson();
-	maze3.print();
-	maze3.svg("Maze2.svg", 4, 4, "red", 1, false);
-	Maze maze4(35, 35);
-	maze4.stampAt(maze3, 5, 5);
-	maze4.generateWilson();
-	maze4.print();
-	maze4.svg("Maze1.svg", 4, 4, "red", 1, true);
-/*	
-//*/
-/*
-	long min_dist;
-	int min_i = 0;
-	for (int i = 1; ; i++)
-	{
-		srand(i);
-		Maze maze2(6, 6);
-		maze2.generateRecursive();
-		Maze maze(30, 30);
-		maze.stampStreched(maze2);
-		maze.generateWilson();
-		long dist = maze.calcDist();
-		printf(" %ld\n", dist);
-		if (min_i == 0 || dist < min_dist)
-		{
-			min_dist = dist;
-			min_i = i;
-		}
-		if (i % 1000 == 0)
-		{
-			srand(min_i);
-			Maze maze2(6, 6);
-			maze2.generateRecursive();
-			Maze maze(30, 30);
-			maze.stampStreched(maze2);
-			maze.generateWilson();
-			printf("\nDist = %ld\n", maze.calcDist());
-			maze.svg("Maze.svg", 2, 8, "red", 1, true);
-			maze.svg("Maze2.svg", 5, 5, "red", 1, true);
-		}
-	}
-//*/
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <new>
+
+class Stat
+{
+public:
+	Stat() : _sum(0.0), _sqrsum(0.0), _n(0) {}
+	void add(double v)
+	{
+		_sum += v;
+		_sqrsum += v*v;
+		_n++;
+	}
+	double avg() { return _sum / _n; }
+	double stddev() { return sqrt((_sqrsum - (_sum * _sum)/_n)/(_n - 1)); }
+	void merge(const Stat &s)
+	{
+		_sum += s._sum;
+		_sqrsum += s._sqrsum;
+		_n += s._n;
+	}
+	static double dist(Stat &p, Stat &q)
+	{
+		// https://en.wikipedia.org/wiki/Bhattacharyya_distance
+		double avg_p = p.avg();
+		double std2_p = p.stddev();
+		std2_p = std2_p * std2_p;
+		double avg_q = q.avg();
+		double std2_q = q.stddev();
+		std2_q = std2_q * std2_q;
+		
+		return ( log((std2_p/std2_q + std2_q/std2_p + 2)/4)
+		       + (avg_p - avg_q)*(avg_p - avg_q)/(std2_p + std2_q)
+		       )/4;
+	}
+private:
+	double _sum;
+	double _sqrsum;
+	int _n;
+};
+
+
+
+// xoshiro256** random number generator (https://prng.di.unimi.it/),
+// with its state initialized from a 64-bit seed through splitmix64
+class Xoshiro256
+{
+public:
+	Xoshiro256(uint64_t s = 0) { seed(s); }
+	void seed(uint64_t s)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			_s[i] = z ^ (z >> 31);
+		}
+	}
+	uint64_t next()
+	{
+		uint64_t result = _rotl(_s[1] * 5, 7) * 9;
+		uint64_t t = _s[1] << 17;
+		_s[2] ^= _s[0];
+		_s[3] ^= _s[1];
+		_s[1] ^= _s[2];
+		_s[0] ^= _s[3];
+		_s[2] ^= t;
+		_s[3] = _rotl(_s[3], 45);
+		return result;
+	}
+	// Returns a number in the range 0 to n-1 without modulo bias
+	// (https://arxiv.org/abs/1805.10941)
+	int below(int n)
+	{
+		uint64_t m = (next() >> 32) * (uint32_t)n;
+		if ((uint32_t)m < (uint32_t)n)
+		{
+			uint32_t t = -(uint32_t)n % (uint32_t)n;
+			while ((uint32_t)m < t)
+				m = (next() >> 32) * (uint32_t)n;
+		}
+		return (int)(m >> 32);
+	}
+private:
+	static uint64_t _rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+	uint64_t _s[4];
+};
+
+enum edge_state { s_passage, s_wall, s_hard_wall };
+
+// Storage for the edges of a maze with one edge_state per edge
+class StatePlane
+{
+public:
+	typedef edge_state &Ref;
+	StatePlane() : _edges(0), _n(0), _capacity(0) {}
+	~StatePlane() { delete[] _edges; }
+	// Keeps the storage when it is large enough
+	void init(int n, edge_state s)
+	{
+		if (n > _capacity)
+		{
+			delete[] _edges;
+			_edges = new edge_state[n];
+			_capacity = n;
+		}
+		_n = n;
+		for (int i = 0; i < n; i++)
+			_edges[i] = s;
+	}
+	Ref operator[](int i) { return _edges[i]; }
+	// Makes edge i a passage; safe while other threads write other edges
+	void open(int i) { _edges[i] = s_passage; }
+	// Returns a mask with bit 2k set when edge i+k is a passage, for k < 32
+	uint64_t passages(int i)
+	{
+		uint64_t mask = 0;
+		for (int k = 0; k < 32 && i + k < _n; k++)
+			mask |= (uint64_t)(_edges[i + k] == s_passage) << (2*k);
+		return mask;
+	}
+	long bytes() { return _n * (long)sizeof(edge_state); }
+	void swap(StatePlane &p)
+	{
+		std::swap(_edges, p._edges);
+		std::swap(_n, p._n);
+		std::swap(_capacity, p._capacity);
+	}
+private:
+	edge_state *_edges;
+	int _n;
+	int _capacity;
+};
+
+// Storage for the edges of a maze with two bits per edge, sixteen
+// edges to a word. Elements are accessed through a proxy reference,
+// such that code can assign and compare them as if they were states.
+class PackedPlane
+{
+public:
+	class Ref
+	{
+	public:
+		Ref(unsigned *word, int shift) : _word(word), _shift(shift) {}
+		operator edge_state() const { return (edge_state)((*_word >> _shift) & 3); }
+		Ref &operator=(edge_state s)
+		{
+			*_word = (*_word & ~(3u << _shift)) | ((unsigned)s << _shift);
+			return *this;
+		}
+		Ref &operator=(const Ref &r) { return *this = (edge_state)r; }
+	private:
+		unsigned *_word;
+		int _shift;
+	};
+	PackedPlane() : _words(0), _n(0), _capacity(0), _owned(true) {}
+	~PackedPlane() { _release(); }
+	// Keeps the storage when it is owned and large enough
+	void init(int n, edge_state s)
+	{
+		_n = n;
+		if (!_owned || nrWords() > _capacity)
+		{
+			_release();
+			_words = new unsigned[nrWords()];
+			_capacity = nrWords();
+			_owned = true;
+		}
+		unsigned word = 0;
+		for (int k = 0; k < 16; k++)
+			word |= (unsigned)s << (2*k);
+		for (int i = 0; i < nrWords(); i++)
+			_words[i] = word;
+	}
+	// Uses the n edges stored in words, which are owned by the caller,
+	// for example because they are part of a mapped file
+	void attach(unsigned *words, int n)
+	{
+		_release();
+		_words = words;
+		_n = n;
+		_owned = false;
+	}
+	void swap(PackedPlane &p)
+	{
+		std::swap(_words, p._words);
+		std::swap(_n, p._n);
+		std::swap(_capacity, p._capacity);
+		std::swap(_owned, p._owned);
+	}
+	Ref operator[](int i) { return Ref(_words + (i >> 4), (i & 15) * 2); }
+	// Makes edge i a passage; safe while other threads write other edges
+	// in the same word, because the bits are cleared atomically
+	void open(int i) { __atomic_fetch_and(_words + (i >> 4), ~(3u << ((i & 15) * 2)), __ATOMIC_RELAXED); }
+	// Returns a mask with bit 2k set when edge i+k is a passage, for k < 32.
+	// A passage has both bits cleared.
+	uint64_t passages(int i)
+	{
+		int a = i >> 4;
+		int shift = (i & 15) * 2;
+		int n = nrWords();
+		uint64_t edges = _words[a] | (a + 1 < n ? (uint64_t)_words[a + 1] << 32 : 0);
+		edges >>= shift;
+		if (shift > 0 && a + 2 < n)
+			edges |= (uint64_t)_words[a + 2] << (64 - shift);
+		return ~(edges | edges >> 1) & 0x5555555555555555ull;
+	}
+	long bytes() { return _owned ? nrWords() * (long)sizeof(unsigned) : 0; }
+	unsigned *words() { return _words; }
+	int nrWords() { return (_n + 15) / 16; }
+private:
+	void _release()
+	{
+		if (_owned)
+			delete[] _words;
+		_words = 0;
+		_capacity = 0;
+	}
+	unsigned *_words;
+	int _n;
+	int _capacity;
+	bool _owned;
+};
+
+// The layouts map the cells (x,y) of a grid of pw by ph cells onto
+// indices, which are used for the planes and for scratch arrays. next
+// returns the neighbouring cell in direction d (0: right, 1: down,
+// 2: left, 3: up) and edgeCell the cell holding the traversal in that
+// direction, which is the cell itself for right and down.
+
+// The cells row by row
+class RowLayout
+{
+public:
+	void init(int pw, int ph)
+	{
+		_pw = pw;
+		_ph = ph;
+		_step[0] = 1;    _offset[0] = 0;
+		_step[1] = pw;   _offset[1] = 0;
+		_step[2] = -1;   _offset[2] = -1;
+		_step[3] = -pw;  _offset[3] = -pw;
+	}
+	int cell(int x, int y) { return x + _pw*y; }
+	int next(int c, int d) { return c + _step[d]; }
+	int edgeCell(int c, int d) { return c + _offset[d]; }
+	int nrCells() { return _pw*_ph; }
+	static const char *name() { return "row"; }
+private:
+	int _pw, _ph;
+	int _step[4];
+	int _offset[4];
+};
+
+// The cells in tiles of 16 by 16 cells, with the tiles row by row and
+// the cells of a tile in Z-order (Morton order): the bits of x and y
+// are interleaved, with those of x at the even positions. A tile of a
+// PackedPlane fills one cache line, and rooms close to each other in
+// both directions are close in memory. The neighbours are found by
+// incrementing or decrementing the interleaved coordinate, where a
+// carry or borrow moves to the next or previous tile. This is done
+// without branches, with a table per direction, because the direction
+// of a random walk cannot be predicted.
+class MortonLayout
+{
+public:
+	void init(int pw, int ph)
+	{
+		_tw = (pw + 15) / 16;
+		_th = (ph + 15) / 16;
+		for (int d = 0; d < 8; d++)
+		{
+			// Directions 4 to 7 give the cell holding the traversal,
+			// which for right and down is the cell itself
+			int dir = d & 3;
+			int mask = dir & 1 ? 0xAA : 0x55;
+			bool self = d >= 4 && dir < 2;
+			_fill[d] = dir < 2 && !self ? 255 ^ mask : 0;
+			_and[d] = dir < 2 ? 255 : mask;
+			_add[d] = self ? 0 : dir == 0 ? 1 : dir == 1 ? 2 : dir == 2 ? -1 : -2;
+			_mask[d] = self ? 255 : mask;
+			_tile[d] = dir & 1 ? _tw : 1;
+		}
+	}
+	int cell(int x, int y)
+	{
+		return ((x >> 4) + _tw*(y >> 4)) * 256 + _spread(x & 15) + 2*_spread(y & 15);
+	}
+	int next(int c, int d) { return _move(c, d); }
+	int edgeCell(int c, int d) { return _move(c, d + 4); }
+	int nrCells() { return _tw*_th*256; }
+	static const char *name() { return "morton"; }
+private:
+	int _move(int c, int d)
+	{
+		int lo = c & 255;
+		int t = ((lo | _fill[d]) & _and[d]) + _add[d];
+		return (c & ~255) + (t >> 8) * _tile[d] * 256 + (t & _mask[d]) + (lo & ~_mask[d] & 255);
+	}
+	static int _spread(int v) { return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2) | ((v & 8) << 3); }
+	int _tw, _th;
+	int _fill[8], _and[8], _add[8], _mask[8], _tile[8];
+};
+
+// Scratch memory for the operations on mazes. Arrays are taken from a
+// single block in a last-in first-out order: mark returns the current
+// position and release gives back everything taken after it. Each mark
+// must be released. When the block is too small, arrays are allocated
+// separately, and when the outermost mark is released the block is
+// replaced by one that also holds these. Thus,
+// after the first time, repeating the same operations does no heap
+// allocation. The arrays are not initialized.
+class Workspace
+{
+public:
+	Workspace() : _block(0), _size(0), _used(0), _nr_marks(0), _extra(0), _extra_size(0) {}
+	~Workspace()
+	{
+		_freeExtra();
+		delete[] _block;
+	}
+	template <class T>
+	T *alloc(long n)
+	{
+		long size = (n * (long)sizeof(T) + 15) & ~15L;
+		if (_used + size <= _size)
+		{
+			T *result = (T*)(_block + _used);
+			_used += size;
+			return result;
+		}
+		// Each separate array is preceded by the link to the previous one
+		char *extra = new char[16 + size];
+		*(char**)extra = _extra;
+		_extra = extra;
+		_extra_size += size;
+		return (T*)(extra + 16);
+	}
+	long mark()
+	{
+		_nr_marks++;
+		return _used;
+	}
+	void release(long mark)
+	{
+		_used = mark;
+		if (--_nr_marks == 0 && _extra != 0)
+		{
+			long size = _size + _extra_size;
+			_freeExtra();
+			delete[] _block;
+			_block = new char[size];
+			_size = size;
+		}
+	}
+	long bytes() { return _size + _extra_size; }
+	void swap(Workspace &ws)
+	{
+		std::swap(_block, ws._block);
+		std::swap(_size, ws._size);
+		std::swap(_used, ws._used);
+		std::swap(_nr_marks, ws._nr_marks);
+		std::swap(_extra, ws._extra);
+		std::swap(_extra_size, ws._extra_size);
+	}
+private:
+	void _freeExtra()
+	{
+		while (_extra != 0)
+		{
+			char *prev = *(char**)_extra;
+			delete[] _extra;
+			_extra = prev;
+		}
+		_extra_size = 0;
+	}
+	char *_block;
+	long _size;
+	long _used;
+	int _nr_marks;
+	char *_extra;
+	long _extra_size;
+};
+
+// Disjoint sets with path halving and union by size
+class DisjointSets
+{
+public:
+	// Takes the arrays from ws when given, which must outlive the sets
+	DisjointSets(int n, Workspace *ws = 0)
+	  : _parent(ws != 0 ? ws->alloc<int>(n) : new int[n]),
+	    _size(ws != 0 ? ws->alloc<int>(n) : new int[n]),
+	    _owned(ws == 0)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			_parent[i] = i;
+			_size[i] = 1;
+		}
+	}
+	~DisjointSets()
+	{
+		if (_owned)
+		{
+			delete[] _parent;
+			delete[] _size;
+		}
+	}
+	// Hints that a is used soon, for walking the sets in a random order
+	void prefetch(int a) { __builtin_prefetch(_parent + a); }
+	int find(int a)
+	{
+		while (_parent[a] != a)
+		{
+			_parent[a] = _parent[_parent[a]];
+			a = _parent[a];
+		}
+		return a;
+	}
+	// Joins the sets of a and b. Returns false if they already were the same set
+	bool join(int a, int b)
+	{
+		a = find(a);
+		b = find(b);
+		if (a == b)
+			return false;
+		if (_size[a] < _size[b])
+		{
+			int t = a;
+			a = b;
+			b = t;
+		}
+		_parent[b] = a;
+		_size[a] += _size[b];
+		return true;
+	}
+private:
+	int *_parent;
+	int *_size;
+	bool _owned;
+};
+
+// A pool of threads that run tasks, which can spawn further tasks.
+// Each thread has a queue of its own: it takes the task it spawned last
+// and, when its queue is empty, steals the oldest task of another one.
+// Tasks are given the index of the thread that runs them, which they
+// pass to spawn. run returns when all tasks have been done.
+class TaskPool
+{
+public:
+	typedef std::function<void(int)> Task;
+	TaskPool(int nr_threads) : _nr_threads(nr_threads), _pending(0)
+	{
+		if (_nr_threads <= 0)
+			_nr_threads = std::thread::hardware_concurrency();
+		if (_nr_threads <= 0)
+			_nr_threads = 1;
+		_queues = new Queue[_nr_threads];
+	}
+	~TaskPool() { delete[] _queues; }
+	int nrThreads() { return _nr_threads; }
+	void spawn(int worker, const Task &task)
+	{
+		_pending++;
+		std::lock_guard<std::mutex> lock(_queues[worker].mutex);
+		_queues[worker].tasks.push_back(task);
+	}
+	void run()
+	{
+		std::thread *workers = new std::thread[_nr_threads-1];
+		for (int t = 0; t < _nr_threads-1; t++)
+			workers[t] = std::thread(&TaskPool::_work, this, t+1);
+		_work(0);
+		for (int t = 0; t < _nr_threads-1; t++)
+			workers[t].join();
+		delete[] workers;
+	}
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+	void _work(int worker)
+	{
+		while (_pending > 0)
+		{
+			Task task;
+			if (_take(worker, task) || _steal(worker, task))
+			{
+				task(worker);
+				_pending--;
+			}
+			else
+				std::this_thread::yield();
+		}
+	}
+	bool _take(int worker, Task &task)
+	{
+		Queue &queue = _queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			return false;
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+	bool _steal(int worker, Task &task)
+	{
+		for (int k = 1; k < _nr_threads; k++)
+		{
+			Queue &queue = _queues[(worker + k) % _nr_threads];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+	int _nr_threads;
+	Queue *_queues;
+	// The number of tasks spawned and not yet done
+	std::atomic<int> _pending;
+};
+
+// A forest stored as Euler tours kept in treaps, such that edges can be
+// added and removed, and the vertex with the smallest key in a tree can
+// be found, in logarithmic expected time. Node v represents vertex v
+// and the two nodes of edge e the traversals of that edge in both
+// directions. A tree on the vertices holds at most n-1 edges.
+class EulerTourTrees
+{
+public:
+	// Takes the arrays from ws when given, which must outlive the trees
+	EulerTourTrees(int n, uint64_t seed, Workspace *ws = 0) : _n(n), _nr_free(n), _owned(ws == 0)
+	{
+		int nr_nodes = 3*n;
+		_left = _alloc<int>(nr_nodes, ws);
+		_right = _alloc<int>(nr_nodes, ws);
+		_parent = _alloc<int>(nr_nodes, ws);
+		_min = _alloc<int>(nr_nodes, ws);
+		_count = _alloc<int>(nr_nodes, ws);
+		_prio = _alloc<uint32_t>(nr_nodes, ws);
+		_key = _alloc<int>(n, ws);
+		_free = _alloc<int>(n, ws);
+		Xoshiro256 rng(seed);
+		for (int x = 0; x < nr_nodes; x++)
+		{
+			_prio[x] = (uint32_t)(rng.next() >> 32);
+			_single(x);
+		}
+		for (int v = 0; v < n; v++)
+		{
+			_key[v] = 0;
+			_free[v] = n-1 - v;
+		}
+	}
+	~EulerTourTrees()
+	{
+		if (!_owned)
+			return;
+		delete[] _left;
+		delete[] _right;
+		delete[] _parent;
+		delete[] _min;
+		delete[] _count;
+		delete[] _prio;
+		delete[] _key;
+		delete[] _free;
+	}
+	void setKey(int v, int key)
+	{
+		_key[v] = key;
+		for (int x = v; x != -1; x = _parent[x])
+			_update(x);
+	}
+	// Returns an unused edge, for building a tree with build
+	int newEdge() { return _free[--_nr_free]; }
+	int edgeNode(int e, int side) { return _n + 2*e + side; }
+	// Builds a tree from the nodes of its Euler tour, which holds each
+	// vertex once and each edge twice: node(e, 0) before and node(e, 1)
+	// after the part of the tour on the other side of the edge.
+	void build(const int *tour, int len, int *stack)
+	{
+		int sp = 0;
+		for (int t = 0; t < len; t++)
+		{
+			int x = tour[t];
+			int last = -1;
+			while (sp > 0 && _prio[stack[sp-1]] < _prio[x])
+			{
+				last = stack[--sp];
+				_update(last);
+			}
+			_left[x] = last;
+			_right[x] = -1;
+			_parent[x] = -1;
+			if (last != -1)
+				_parent[last] = x;
+			if (sp > 0)
+			{
+				_right[stack[sp-1]] = x;
+				_parent[x] = stack[sp-1];
+			}
+			stack[sp++] = x;
+		}
+		while (sp > 0)
+			_update(stack[--sp]);
+	}
+	bool connected(int u, int v) { return _root(u) == _root(v); }
+	// Joins the trees of u and v with an edge, which is returned
+	int link(int u, int v)
+	{
+		int e = newEdge();
+		int a = edgeNode(e, 0);
+		int b = edgeNode(e, 1);
+		_single(a);
+		_single(b);
+		int tu = _reroot(u);
+		int tv = _reroot(v);
+		_merge(_merge(tu, a), _merge(tv, b));
+		return e;
+	}
+	// Removes edge e, splitting its tree in two
+	void cut(int e)
+	{
+		int a = edgeNode(e, 0);
+		int b = edgeNode(e, 1);
+		int l, r, m;
+		// Make the tour start with a, such that it is a, the tour on
+		// one side of the edge, b, and the tour on the other side
+		_split(a, false, l, r);
+		_merge(r, l);
+		_split(b, false, l, r);
+		_split(a, true, m, l);
+		_split(b, true, m, r);
+		_free[_nr_free++] = e;
+	}
+	// Returns the vertex with the smallest key in the tree of v, and of
+	// those the first in the tour
+	int minVertex(int v) { return _min[_root(v)]; }
+	int size(int v) { return _count[_root(v)]; }
+	// Stores the vertices of the tree of v in result and returns their number
+	int vertices(int v, int *result)
+	{
+		int n = 0;
+		int x = _root(v);
+		while (_left[x] != -1)
+			x = _left[x];
+		while (x != -1)
+		{
+			if (x < _n)
+				result[n++] = x;
+			if (_right[x] != -1)
+			{
+				x = _right[x];
+				while (_left[x] != -1)
+					x = _left[x];
+			}
+			else
+			{
+				while (_parent[x] != -1 && _right[_parent[x]] == x)
+					x = _parent[x];
+				x = _parent[x];
+			}
+		}
+		return n;
+	}
+private:
+	template <class T>
+	static T *_alloc(int n, Workspace *ws) { return ws != 0 ? ws->alloc<T>(n) : new T[n]; }
+	void _single(int x)
+	{
+		_left[x] = _right[x] = _parent[x] = -1;
+		_update(x);
+	}
+	void _update(int x)
+	{
+		int l = _left[x];
+		int r = _right[x];
+		_count[x] = x < _n ? 1 : 0;
+		_min[x] = -1;
+		if (l != -1)
+		{
+			_count[x] += _count[l];
+			_min[x] = _min[l];
+		}
+		if (x < _n && (_min[x] == -1 || _key[x] < _key[_min[x]]))
+			_min[x] = x;
+		if (r != -1)
+		{
+			_count[x] += _count[r];
+			if (_min[r] != -1 && (_min[x] == -1 || _key[_min[r]] < _key[_min[x]]))
+				_min[x] = _min[r];
+		}
+	}
+	int _root(int x)
+	{
+		while (_parent[x] != -1)
+			x = _parent[x];
+		return x;
+	}
+	int _merge(int a, int b)
+	{
+		if (a == -1)
+			return b;
+		if (b == -1)
+			return a;
+		if (_prio[a] > _prio[b])
+		{
+			int m = _merge(_right[a], b);
+			_right[a] = m;
+			_parent[m] = a;
+			_update(a);
+			return a;
+		}
+		int m = _merge(a, _left[b]);
+		_left[b] = m;
+		_parent[m] = b;
+		_update(b);
+		return b;
+	}
+	// Splits the tree holding x in the nodes before and after x, where x
+	// goes to the left part when x_left is true
+	void _split(int x, bool x_left, int &l, int &r)
+	{
+		if (x_left)
+		{
+			l = x;
+			r = _right[x];
+			_right[x] = -1;
+		}
+		else
+		{
+			r = x;
+			l = _left[x];
+			_left[x] = -1;
+		}
+		_update(x);
+		int c = x;
+		for (int p = _parent[x]; p != -1; p = _parent[c])
+		{
+			if (_left[p] == c)
+			{
+				_left[p] = r;
+				if (r != -1)
+					_parent[r] = p;
+				r = p;
+			}
+			else
+			{
+				_right[p] = l;
+				if (l != -1)
+					_parent[l] = p;
+				l = p;
+			}
+			_update(p);
+			c = p;
+		}
+		if (l != -1)
+			_parent[l] = -1;
+		if (r != -1)
+			_parent[r] = -1;
+	}
+	int _reroot(int v)
+	{
+		int l, r;
+		_split(v, false, l, r);
+		return _merge(r, l);
+	}
+	int _n;
+	int *_left;
+	int *_right;
+	int *_parent;
+	int *_min;
+	int *_count;
+	uint32_t *_prio;
+	int *_key;
+	int *_free;
+	int _nr_free;
+	bool _owned;
+};
+
+// Counters of the work done in the hot paths of a maze, for finding out
+// where the time goes. They are only maintained when compiled with
+// MAZE_STATS defined, and otherwise cost nothing.
+class MazeCounters
+{
+public:
+	MazeCounters() { reset(); }
+	void reset()
+	{
+		iterator_steps = 0;
+		wilson_walks = wilson_walk_steps = wilson_erased = 0;
+		fix_calls = fix_candidates = fix_flips = 0;
+		crosses_found = cross_scans = 0;
+		recurse_depth = recurse_max_depth = 0;
+	}
+	void merge(const MazeCounters &c)
+	{
+		iterator_steps += c.iterator_steps;
+		wilson_walks += c.wilson_walks;
+		wilson_walk_steps += c.wilson_walk_steps;
+		wilson_erased += c.wilson_erased;
+		fix_calls += c.fix_calls;
+		fix_candidates += c.fix_candidates;
+		fix_flips += c.fix_flips;
+		crosses_found += c.crosses_found;
+		cross_scans += c.cross_scans;
+		if (c.recurse_max_depth > recurse_max_depth)
+			recurse_max_depth = c.recurse_max_depth;
+	}
+	void dump(FILE *f)
+	{
+		fprintf(f, "iterator steps      %ld\n", iterator_steps);
+		fprintf(f, "Wilson walks        %ld, %ld steps, %ld erased\n", wilson_walks, wilson_walk_steps, wilson_erased);
+		fprintf(f, "_fix calls          %ld, %ld candidates, %ld flipped\n", fix_calls, fix_candidates, fix_flips);
+		fprintf(f, "removeCrosses       %ld crosses, %ld scans\n", crosses_found, cross_scans);
+		fprintf(f, "_recurse max depth  %ld\n", recurse_max_depth);
+	}
+	long iterator_steps;
+	long wilson_walks, wilson_walk_steps, wilson_erased;
+	long fix_calls, fix_candidates, fix_flips;
+	long crosses_found, cross_scans;
+	long recurse_depth, recurse_max_depth;
+};
+
+#ifdef MAZE_STATS
+#define MAZE_COUNT(maze, counter, n) ((maze)._counters.counter += (n))
+#define MAZE_COUNT_MAX(maze, counter, v) do { if ((v) > (maze)._counters.counter) (maze)._counters.counter = (v); } while (0)
+#else
+#define MAZE_COUNT(maze, counter, n) ((void)0)
+#define MAZE_COUNT_MAX(maze, counter, v) ((void)0)
+#endif
+
+// Header of a binary maze file. It is followed by the words of the
+// two packed (padded) edge planes of the maze, in the byte order of the
+// machine that wrote it, such that the file can be mapped into memory
+// and used as it is. byte_order holds 0x01020304 as written.
+class MazeFileHeader
+{
+public:
+	char magic[4];
+	uint32_t byte_order;
+	uint32_t version;
+	int32_t w, h;
+	int32_t algorithm;
+	uint64_t seed;
+};
+
+template <class Plane = PackedPlane, class Rng = Xoshiro256, class Layout = RowLayout>
+class MazeT
+{
+	template <class P, class R, class L> friend class MazeT;
+private:
+	typedef edge_state state;
+	typedef typename Plane::Ref ref;
+public:
+	MazeT(int w, int h, uint64_t seed = 0) : _ws(0)
+	{
+		reset(w, h, seed);
+	}
+	MazeT(MazeT &&maze) : _w(0), _h(0), _seed(0), _algorithm(-1), _ws(0)
+	{
+		_initOffsets();
+		swap(maze);
+	}
+	MazeT &operator=(MazeT &&maze)
+	{
+		swap(maze);
+		return *this;
+	}
+	MazeT(const MazeT &) = delete;
+	MazeT &operator=(const MazeT &) = delete;
+	// Returns the maze to the state after construction, keeping the
+	// storage of the planes when it is large enough. The counters are
+	// kept, such that they add up over the mazes.
+	void reset(int w, int h, uint64_t seed)
+	{
+		_w = w;
+		_h = h;
+		_algorithm = -1;
+		this->seed(seed);
+		_initOffsets();
+		_planes[0].init(nrCells(), s_hard_wall);
+		_planes[1].init(nrCells(), s_hard_wall);
+		for (int i = 0; i < _w; i++)
+			for (int j = 0; j < _h; j++)
+			{
+				if (i < _w-1)
+					right(i, j) = s_wall;
+				if (j < _h-1)
+					bottom(i, j) = s_wall;
+			}
+	}
+	void reset(uint64_t seed) { reset(_w, _h, seed); }
+	void swap(MazeT &maze)
+	{
+		std::swap(_w, maze._w);
+		std::swap(_h, maze._h);
+		std::swap(_seed, maze._seed);
+		std::swap(_algorithm, maze._algorithm);
+		std::swap(_layout, maze._layout);
+		_planes[0].swap(maze._planes[0]);
+		_planes[1].swap(maze._planes[1]);
+		std::swap(_rng, maze._rng);
+		_workspace.swap(maze._workspace);
+		std::swap(_ws, maze._ws);
+#ifdef MAZE_STATS
+		std::swap(_counters, maze._counters);
+#endif
+	}
+	// Takes the scratch memory of the operations from ws instead of from
+	// the workspace of the maze itself, such that mazes can share one.
+	// Passing 0 returns to the own workspace.
+	void useWorkspace(Workspace *ws) { _ws = ws; }
+	static const char *layoutName() { return Layout::name(); }
+	Workspace &workspace() { return _scratch(); }
+	// Uses the planes that follow the header in memory, as written by
+	// save, which are in the row layout
+	MazeT(MazeFileHeader *header) : _w(header->w), _h(header->h), _seed(header->seed), _algorithm(header->algorithm), _rng(header->seed), _ws(0)
+	{
+		_initOffsets();
+		unsigned *words = (unsigned*)(header + 1);
+		_planes[0].attach(words, nrCells());
+		_planes[1].attach(words + _planes[0].nrWords(), nrCells());
+	}
+	ref right(int i, int j) { /*printf("right(%d,%d)\n", i, j);*/return _planes[0][_cell(i, j)]; }
+	ref left(int i, int j) { /*printf("left(%d,%d)\n", i, j);*/return _planes[0][_layout.edgeCell(_cell(i, j), 2)]; }
+	ref bottom(int i, int j) { /*printf("bottom(%d,%d)\n", i, j);*/return _planes[1][_cell(i, j)]; }
+	ref top(int i, int j) { /*printf("top(%d,%d)\n", i, j);*/return _planes[1][_layout.edgeCell(_cell(i, j), 3)]; }
+	void seed(uint64_t seed) { _seed = seed; _rng.seed(seed); }
+	long bytes() { return sizeof(*this) + _planes[0].bytes() + _planes[1].bytes() + _workspace.bytes(); }
+	// The number of cells in the layout, including the border ring
+	int nrCells() { return _layout.nrCells(); }
+#ifdef MAZE_STATS
+	MazeCounters &counters() { return _counters; }
+#endif
+	void dumpCounters(FILE *f = stdout)
+	{
+#ifdef MAZE_STATS
+		_counters.dump(f);
+#else
+		fprintf(f, "Counters are only available when compiled with MAZE_STATS\n");
+#endif
+	}
+
+	void generateRecursive()
+	{
+		_algorithm = alg_recursive;
+		// from records for each visited room the direction (plus one)
+		// back to the room it was entered from, such that the search
+		// can backtrack without a stack. Zero means not visited.
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		// Like the planes, it is indexed by cell.
+		char *from = ws.alloc<char>(nrCells());
+		for (int c = 0; c < nrCells(); c++)
+			from[c] = 0;
+		// Start a search in every part that hard walls separate
+		for (int j = 0; j < _h; j++)
+			for (int i = 0; i < _w; i++)
+				if (from[_cell(i, j)] == 0)
+					_recurse(_cell(i, j), from);
+		ws.release(mark);
+	}
+	void generateSplit(int nr_threads = 1)
+	{
+		// The two halves of a division share nothing but the passage
+		// between them, so with more than one thread the halves of the
+		// larger divisions are generated as tasks on a pool. Each of
+		// these gets a random stream of its own, seeded from the stream
+		// of the division, such that the maze only depends on the seed.
+		_algorithm = alg_split;
+		Rng rng(_rng.next());
+		if (nr_threads == 1)
+			_split(0, 0, _w, _h, rng, 0, 0);
+		else
+		{
+			TaskPool pool(nr_threads);
+			pool.spawn(0, [this, &rng, &pool](int worker) { _split(0, 0, _w, _h, rng, &pool, worker); });
+			pool.run();
+		}
+	}
+	enum frac_type { frac_regular, frac_reverse, frac_random_orient_no_cross, frac_reverse_random_orient_no_cross, frac_random_orient, frac_all_random };
+	void generateFractal(frac_type type, int nr_threads = 1)
+	{
+		generateFractal(_w/2, _h/2, type, nr_threads);
+	}
+	// generateTrees, generateDig and generateRandom return the number of
+	// traversals that the repair into a spanning tree changed
+	int generateTrees()
+	{
+		_algorithm = alg_trees;
+		for (int p = 0; p < 2; p++)
+			for (int c = 0; c < nrCells(); c++)
+				if (_planes[p][c] != s_hard_wall)
+					_planes[p][c] = s_passage;
+		return _fix();
+	}
+	int generateDig()
+	{
+		_algorithm = alg_dig;
+		return _fix();
+	}
+	void generateWilson()
+	{
+		_algorithm = alg_wilson;
+		// https://en.wikipedia.org/wiki/Maze_generation_algorithm#Wilson's_algorithm
+		
+	    // Algorithm assums that all traversals are marked as s_wall.
+	
+		// state is used for recording walking direction from a room (using 0 to 3)
+		// and to record which rooms are included (using 4).
+		// rooms holds the rooms that are not yet included and pos the index
+		// of each of these in rooms, such that a random room can be picked
+		// and removed in constant time. Rooms are identified by their cell.
+		int to_go = 0;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int* state = ws.alloc<int>(nrCells());
+		int* rooms = ws.alloc<int>(_w*_h);
+		int* pos = ws.alloc<int>(nrCells());
+		for (int i = 0; i < _w; i++)
+			for (int j = 0; j < _h; j++)
+			{
+				int c = _cell(i, j);
+				state[c] = 0;
+				for (int d = 0; d < 4; d++)
+					if (_wallAt(c, d) == s_passage)
+					{
+						state[c] = 4;
+						break;
+					}
+				if (state[c] != 4)
+				{
+					pos[c] = to_go;
+					rooms[to_go++] = c;
+				}
+			}
+		bool hard = false;
+		for (int k = 0; k < (_w-1)*_h + _w*(_h-1) && !hard; k++)
+			hard = _edge(k) == s_hard_wall;
+		if (!hard)
+		{
+			if (to_go == _w*_h)
+			{
+				// Mark random room as included
+				int i = _rand(_w);
+				int c = _cell(i, _rand(_h));
+				state[c] = 4;
+				_include(c, rooms, pos, to_go);
+			}
+		}
+		else
+		{
+			// Hard walls can divide the maze into separate parts. Mark a
+			// random room as included in each part without included rooms,
+			// as otherwise the walks in that part would never end.
+			int *label = ws.alloc<int>(_w*_h);
+			int *chosen = ws.alloc<int>(_w*_h);
+			int *count = ws.alloc<int>(_w*_h);
+			int nr = _components(label, chosen, s_hard_wall);
+			for (int c = 0; c < nr; c++)
+				count[c] = 0;
+			for (int r = 0; r < _w*_h; r++)
+				if (state[_cell(r % _w, r / _w)] == 4)
+					count[label[r]] = -1;
+			for (int r = 0; r < _w*_h; r++)
+				if (count[label[r]] >= 0 && _rand(++count[label[r]]) == 0)
+					chosen[label[r]] = _cell(r % _w, r / _w);
+			for (int c = 0; c < nr; c++)
+				if (count[c] > 0)
+				{
+					state[chosen[c]] = 4;
+					_include(chosen[c], rooms, pos, to_go);
+				}
+		}
+
+		// While there are still rooms not included
+		while (to_go > 0)
+		{
+			//printf("to go %d: ", to_go);
+			// Pick a random room that is not yet included
+			int s = rooms[_rand(to_go)];
+			// Perform a random walk from this room until
+			// an included room is found, marking the directions
+			int c = s;
+			MAZE_COUNT(*this, wilson_walks, 1);
+			while (state[c] != 4)
+			{
+				int d = _rand(4);
+				if (_wallAt(c, d) != s_hard_wall)
+				{
+					MAZE_COUNT(*this, wilson_walk_steps, 1);
+					MAZE_COUNT(*this, wilson_erased, 1);
+					state[c] = d;
+					c = _layout.next(c, d);
+				}
+			}
+			//printf("found\n");
+			// Start from the initial room, following the
+			// marked directions, marking them as included
+			// and making all traversals into a passage 
+			c = s;
+			while (state[c] != 4)
+			{
+				int d = state[c];
+				state[c] = 4;
+				_include(c, rooms, pos, to_go);
+				MAZE_COUNT(*this, wilson_erased, -1);
+				_wallAt(c, d) = s_passage;
+				c = _layout.next(c, d);
+			}
+		}
+		ws.release(mark);
+	}
+	// Generates the rooms outside the rectangle of w by h rooms at (x, y)
+	// with Wilson's algorithm, where the rectangle already holds a maze,
+	// for example placed with stampAt, and the rooms outside it have no
+	// passages yet. Only the rooms outside the rectangle and those along
+	// its border are visited, such that the work is proportional to the
+	// new area.
+	void generateWilsonAround(int x, int y, int w, int h)
+	{
+		_algorithm = alg_wilson;
+		_wilsonRing(0, 0, _w, _h, x, y, w, h);
+	}
+	// Grows a maze outward from the maze in the rectangle of w by h rooms
+	// at (x, y) in layers of margin rooms wide, generating each layer as
+	// generateWilsonAround would for a maze of its size, such that the
+	// result is like a series of nested mazes, each placed in the next
+	// with stampAt. As stampAt does, the walls of all but the outer layer
+	// are made hard walls. Returns false, without changing the maze, when
+	// margin is not positive or the rectangle does not fit in the maze.
+	bool generateLayers(int x, int y, int w, int h, int margin)
+	{
+		if (margin <= 0 || x < 0 || w < 0 || x + w > _w || y < 0 || h < 0 || y + h > _h)
+			return false;
+		_algorithm = alg_wilson;
+		while (w < _w || h < _h)
+		{
+			int x0 = x - margin > 0 ? x - margin : 0;
+			int y0 = y - margin > 0 ? y - margin : 0;
+			int x1 = x + w + margin < _w ? x + w + margin : _w;
+			int y1 = y + h + margin < _h ? y + h + margin : _h;
+			_wilsonRing(x0, y0, x1 - x0, y1 - y0, x, y, w, h);
+			if (x1 - x0 < _w || y1 - y0 < _h)
+			{
+				// Only the edges of the new layer: those to the right and
+				// below the rooms of the ring, and those leaving the inner
+				// rectangle to the right and below it
+				for (int j = y0; j < y1; j++)
+					for (int i = x0; i < x1; i++)
+						if (i == x && j >= y && j < y + h && w > 0)
+							i += w-1;
+						else
+						{
+							if (i < x1-1)
+								_harden(right(i, j));
+							if (j < y1-1)
+								_harden(bottom(i, j));
+						}
+				for (int j = y; j < y + h && x + w < x1; j++)
+					_harden(right(x + w-1, j));
+				for (int i = x; i < x + w && y + h < y1; i++)
+					_harden(bottom(i, y + h-1));
+			}
+			x = x0;
+			y = y0;
+			w = x1 - x0;
+			h = y1 - y0;
+		}
+		return true;
+	}
+	int generateRandom()
+	{
+		_algorithm = alg_random;
+		int nr_all = 0;
+		for (int p = 0; p < 2; p++)
+			for (int c = 0; c < nrCells(); c++)
+				if (_planes[p][c] != s_hard_wall)
+					nr_all++;
+		int nr_passages = _w * _h - 1;
+		int nr_edges = (_w-1)*_h + _w*(_h-1);
+		for (int k = 0; k < nr_edges; k++)
+			if (_edge(k) != s_hard_wall)
+			{
+				_edge(k) = _rand(nr_all) < nr_passages ? s_passage : s_wall;
+				nr_all--;
+				if (_edge(k) == s_passage)
+					nr_passages--;
+			}
+		return _fix();
+	}
+	void generateKruskal()
+	{
+		// https://en.wikipedia.org/wiki/Kruskal%27s_algorithm
+		// Rooms joined by passages, such as those of a stamped pattern,
+		// start in the same set. The walls that are not hard walls are
+		// visited in a random order, opening those between rooms of
+		// different sets. Sets are kept per cell, and the walls are
+		// numbered twice the cell plus the plane, which saves divisions.
+		_algorithm = alg_kruskal;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int *walls = ws.alloc<int>(2*_w*_h);
+		DisjointSets cells(nrCells(), &ws);
+		int nr_sets = _w*_h;
+		int nr_walls = 0;
+		for (int j = 0; j < _h; j++)
+			for (int i = 0; i < _w; i++)
+			{
+				int c = _cell(i, j);
+				for (int p = 0; p < 2; p++)
+				{
+					// The traversals to the ring are hard walls
+					state s = _planes[p][c];
+					if (s == s_wall)
+						walls[nr_walls++] = 2*c + p;
+					else if (s == s_passage && cells.join(c, _layout.next(c, p)))
+						nr_sets--;
+				}
+			}
+		_shuffle(walls, nr_walls);
+		const int ahead = 16;
+		for (int k = 0; k < nr_walls && nr_sets > 1; k++)
+		{
+			if (k + ahead < nr_walls)
+			{
+				int a = walls[k + ahead] >> 1;
+				cells.prefetch(a);
+				cells.prefetch(_layout.next(a, walls[k + ahead] & 1));
+			}
+			int c = walls[k] >> 1;
+			int p = walls[k] & 1;
+			if (cells.join(c, _layout.next(c, p)))
+			{
+				_planes[p][c] = s_passage;
+				nr_sets--;
+			}
+		}
+		ws.release(mark);
+	}
+	void generateFractal(int i, int j, frac_type type, int nr_threads = 1)
+	{
+		// As for generateSplit, the quadrants of the larger squares get
+		// a random stream of their own and are generated as tasks when
+		// running with more than one thread.
+		_algorithm = alg_fractal_regular + type;
+		int size = 1;
+		while (   i - size > 0 || i + size < _w
+		       || j - size > 0 || j + size < _h)
+			size *= 2;
+		Rng rng(_rng.next());
+		if (nr_threads == 1)
+			_fractal(i, j, size, type, -1, rng, 0, 0);
+		else
+		{
+			TaskPool pool(nr_threads);
+			pool.spawn(0, [&](int worker) { _fractal(i, j, size, type, -1, rng, &pool, worker); });
+			pool.run();
+		}
+	}
+	enum algorithm { alg_recursive, alg_split, alg_trees, alg_dig, alg_wilson, alg_random,
+	                 alg_fractal_regular, alg_fractal_reverse, alg_fractal_random_orient_no_cross,
+	                 alg_fractal_reverse_random_orient_no_cross, alg_fractal_random_orient, alg_fractal_all_random, alg_kruskal };
+	void generate(algorithm alg)
+	{
+		switch (alg)
+		{
+			case alg_recursive: generateRecursive(); break;
+			case alg_split:     generateSplit(); break;
+			case alg_trees:     generateTrees(); break;
+			case alg_dig:       generateDig(); break;
+			case alg_wilson:    generateWilson(); break;
+			case alg_random:    generateRandom(); break;
+			case alg_kruskal:   generateKruskal(); break;
+			default:            generateFractal((frac_type)(alg - alg_fractal_regular)); break;
+		}
+	}
+	void generateTiled(int tile_w, int tile_h, algorithm alg, int nr_threads = 0)
+	{
+		// Divides the maze in tiles and generates each of them with the
+		// given algorithm on a pool of threads. Hard walls are copied into
+		// the tiles, which can divide a tile into separate parts. The
+		// parts are joined into a single maze by opening passages in the
+		// seams between the tiles, visited in a random order, for those
+		// that connect parts that are not yet connected. Without hard
+		// walls this opens one passage in each seam of a random spanning
+		// tree of the tiles, like _split opens one passage per division.
+		_algorithm = alg;
+		if (nr_threads <= 0)
+			nr_threads = std::thread::hardware_concurrency();
+		if (nr_threads <= 0)
+			nr_threads = 1;
+		int nr_tx = (_w + tile_w - 1) / tile_w;
+		int nr_ty = (_h + tile_h - 1) / tile_h;
+		int nr_tiles = nr_tx*nr_ty;
+		// For each tile, the number of parts and the part of each room
+		// along its border: left column, right column, top row, bottom row
+		int *nr_parts = new int[nr_tiles+1];
+		int **border = new int*[nr_tiles];
+		uint64_t seed = _rng.next();
+		std::atomic<int> next(0);
+		std::mutex copy_mutex;
+		std::thread *workers = new std::thread[nr_threads-1];
+		for (int t = 0; t < nr_threads-1; t++)
+			workers[t] = std::thread(&MazeT::_tileWorker, this, tile_w, tile_h, alg, seed, nr_parts, border, &next, &copy_mutex);
+		_tileWorker(tile_w, tile_h, alg, seed, nr_parts, border, &next, &copy_mutex);
+		for (int t = 0; t < nr_threads-1; t++)
+			workers[t].join();
+		delete[] workers;
+
+		// Number the parts of all tiles consecutively
+		int nr_all = 0;
+		for (int t = 0; t < nr_tiles; t++)
+		{
+			int n = nr_parts[t];
+			nr_parts[t] = nr_all;
+			nr_all += n;
+		}
+		// Collect the walls in the seams, numbered as for _edge()
+		int nr_vert = (_w-1)*_h;
+		int nr_seam_edges = 0;
+		int *seam_edges = new int[(nr_tx-1)*_h + (nr_ty-1)*_w + 1];
+		for (int tx = 1; tx < nr_tx; tx++)
+			for (int j = 0; j < _h; j++)
+				if (right(tx*tile_w - 1, j) == s_wall)
+					seam_edges[nr_seam_edges++] = _h*(tx*tile_w - 1) + j;
+		for (int ty = 1; ty < nr_ty; ty++)
+			for (int i = 0; i < _w; i++)
+				if (bottom(i, ty*tile_h - 1) == s_wall)
+					seam_edges[nr_seam_edges++] = nr_vert + i + _w*(ty*tile_h - 1);
+		_shuffle(seam_edges, nr_seam_edges);
+		DisjointSets parts(nr_all);
+		for (int p = 0; p < nr_seam_edges; p++)
+		{
+			int k = seam_edges[p];
+			int a, b;
+			_rooms(k, a, b);
+			int a_i = a % _w, a_j = a / _w;
+			int ta = a_i / tile_w + nr_tx*(a_j / tile_h);
+			int part_a, part_b;
+			int x = a_i % tile_w;
+			int y = a_j % tile_h;
+			int w = _span(a_i - x, tile_w, _w);
+			int h = _span(a_j - y, tile_h, _h);
+			if (k < nr_vert)
+			{
+				part_a = nr_parts[ta] + border[ta][h + y];
+				part_b = nr_parts[ta+1] + border[ta+1][y];
+			}
+			else
+			{
+				part_a = nr_parts[ta] + border[ta][2*h + w + x];
+				part_b = nr_parts[ta+nr_tx] + border[ta+nr_tx][2*_span(a_j+1, tile_h, _h) + x];
+			}
+			if (parts.join(part_a, part_b))
+				_edge(k) = s_passage;
+		}
+		delete[] seam_edges;
+		for (int t = 0; t < nr_tiles; t++)
+			delete[] border[t];
+		delete[] border;
+		delete[] nr_parts;
+	}
+	void print(bool* visited = 0, int ti = -1, int tj = -1)
+	{
+		for (int j = 0; j < _h; j++)
+		{
+			for (int i = 0; i < _w; i++)
+				printf("+%c", _hasWall(i, j, 3) ? (_wall(i, j, 3) == s_wall ? '-' : '=') : ' ');
+			printf("+\n");
+			for (int i = 0; i < _w; i++)
+				printf("%c%c", _hasWall(i, j, 2) ? (_wall(i, j, 2) == s_wall ? ':' : '|') : ' ', i == ti && j == tj ? '*' : visited != 0 && visited[i + _w*j] ? 'x' : ' ');
+			printf("|\n");
+		}
+		for (int i = 0; i < _w; i++)
+			printf("+-");
+		printf("+\n");
+	}
+	void printStats()
+	{
+		int types[16];
+		int one, two_straight, two_turn, three, four;
+		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
+		
+		for (int i = 0; i < 16; i++)
+			if (types[i] > 0)
+			{
+				printf(" ");
+				for (int d = 0; d < 4; d++)
+					if ((i & (1 << d)) != 0)
+						printf("%c", "rblt"[d]);
+				printf(":%d", types[i]);
+			}
+		printf("\n");
+		printf("degree 1: %d\n", one);
+		if (two_straight + two_turn > 0)
+		{
+			printf("degree 2: %d", two_straight + two_turn);
+			if (two_straight > 0)
+				printf(" straight:%d", two_straight);
+			if (two_turn > 0)
+				printf(" turn:%d", two_turn);
+			printf("\n");
+		}
+		printf("degree 3: %d\n", three);
+		if (four > 0)
+			printf("degree 4: %d\n", four);
+	}
+	void printAverageDist()
+	{
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		long *dist = ws.alloc<long>(_w*_h);
+		calcDistances(dist);
+		double sum = 0;
+		double l = 1.0;
+		for (int i = 1; i < _w*_h && dist[i] > 0; i++, l += 1.0)
+		{
+			printf("%ld ", dist[i]);
+			sum += dist[i] * l;
+		}
+		printf(" %lf\n", sum / (_w*_h*(_w*_h-1.0)/2));
+		ws.release(mark);
+	}
+	void calcStats(Stat (&stats)[22])
+	{
+		int types[16];
+		int one, two_straight, two_turn, three, four;
+		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
+		double tot = _w * _h;
+		for (int i = 0; i < 16; i++)
+		{
+			stats[i].add(types[i]/tot);
+			//printf("%d ", types[i]);
+		}
+		stats[16].add(one/tot);
+		stats[17].add(two_straight/tot);
+		stats[18].add(two_turn/tot);
+		stats[19].add(three/tot);
+		stats[20].add(four/tot);
+		stats[21].add(averageDist());
+		//printf("%lf\n", averageDist());
+	}
+	double averageDist()
+	{
+		// The sum of the distances between all pairs of rooms equals the
+		// sum over all passages of the number of pairs that are connected
+		// through it, which is the product of the sizes of the two parts
+		// the maze falls apart in when the passage is removed.
+		int n = _w*_h;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int *order = ws.alloc<int>(n);
+		int *parent = ws.alloc<int>(n);
+		long *size = ws.alloc<long>(n);
+		bool *removed = ws.alloc<bool>(n);
+		for (int r = 0; r < n; r++)
+		{
+			size[r] = 1;
+			removed[r] = false;
+		}
+		// When hard walls divide the maze, only the pairs in the part of
+		// the first room are counted
+		int m = _bfs(0, order, parent, removed);
+		long sum = 0;
+		for (int k = m-1; k > 0; k--)
+		{
+			int r = order[k];
+			sum += size[r] * (m - size[r]);
+			size[parent[r]] += size[r];
+		}
+		ws.release(mark);
+		return sum / (m*(m-1.0)/2);
+	}
+	void calcDistances(long *dist)
+	{
+		// Sets dist[l] to the number of pairs of rooms at distance l, using
+		// centroid decomposition: every pair is counted at the first
+		// centroid that lies on the path between them. At a centroid, the
+		// number of paths through it with length l follow from convolving
+		// the histogram of the depths of all rooms in its component with
+		// itself, and subtracting the same for each of its branches.
+		int n = _w*_h;
+		for (int l = 0; l < n; l++)
+			dist[l] = 0;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int *order = ws.alloc<int>(n);
+		int *parent = ws.alloc<int>(n);
+		int *size = ws.alloc<int>(n);
+		int *depth = ws.alloc<int>(n);
+		bool *removed = ws.alloc<bool>(n);
+		int *todo = ws.alloc<int>(n);
+		long *all = ws.alloc<long>(n+1);
+		long *branch = ws.alloc<long>(n+1);
+		long *conv = ws.alloc<long>(2*n+1);
+		long *pairs = ws.alloc<long>(2*n+1);
+		for (int r = 0; r < n; r++)
+			removed[r] = false;
+		for (int l = 0; l <= 2*n; l++)
+			pairs[l] = 0;
+		int nr_todo = 0;
+		todo[nr_todo++] = 0;
+		while (nr_todo > 0)
+		{
+			int root = todo[--nr_todo];
+			int m = _bfs(root, order, parent, removed);
+
+			// Find the centroid: the room for which removing it leaves
+			// no part with more than half the rooms
+			for (int k = 0; k < m; k++)
+			{
+				size[order[k]] = 1;
+				depth[order[k]] = 0; // largest branch below the room
+			}
+			int centroid = root;
+			for (int k = m-1; k >= 0; k--)
+			{
+				int r = order[k];
+				if (2*depth[r] <= m && 2*(m - size[r]) <= m)
+					centroid = r;
+				if (k > 0)
+				{
+					size[parent[r]] += size[r];
+					if (size[r] > depth[parent[r]])
+						depth[parent[r]] = size[r];
+				}
+			}
+			removed[centroid] = true;
+
+			int max_all = 0;
+			all[0] = 1;
+			int ci = centroid % _w;
+			int cj = centroid / _w;
+			for (int d = 0; d < 4; d++)
+			{
+				int b = _neighbour(centroid, d);
+				if (_hasWall(ci, cj, d) || removed[b])
+					continue;
+				int mb = _bfs(b, order, parent, removed);
+				int max_b = 0;
+				for (int k = 0; k < mb; k++)
+				{
+					int r = order[k];
+					depth[r] = k == 0 ? 1 : depth[parent[r]] + 1;
+					if (depth[r] > max_b)
+					{
+						max_b = depth[r];
+						branch[max_b] = 0;
+						if (max_b > max_all)
+							all[++max_all] = 0;
+					}
+					branch[depth[r]]++;
+					all[depth[r]]++;
+				}
+				branch[0] = 0;
+				_selfConvolve(branch, max_b+1, conv, ws);
+				for (int l = 0; l <= 2*max_b; l++)
+					pairs[l] -= conv[l];
+				todo[nr_todo++] = b;
+			}
+			_selfConvolve(all, max_all+1, conv, ws);
+			// Paths are shorter than n, but in a path-shaped component the
+			// convolutions reach up to length n
+			for (int l = 1; l <= 2*max_all; l++)
+			{
+				if (l < n)
+					dist[l] += (pairs[l] + conv[l]) / 2;
+				pairs[l] = 0;
+			}
+			pairs[0] = 0;
+		}
+		ws.release(mark);
+	}
+	long calcDist()
+	{
+		int types[16];
+		int one, two_straight, two_turn, three, four;
+		_calcStats(types, &one, &two_straight, &two_turn, &three, &four);
+		long result = 0;
+		int exp = _w * _h / 15;
+		for (int i = 1; i < 15; i++)
+		{
+			int d = (exp - types[i]);
+			if (d < 0)
+				d = -d;
+			printf("%4d", d);
+			result += d*d*d;
+		}
+		return result;
+	}
+	// Sets result[0..2n-2] to the convolution of a[0..n-1] with itself,
+	// as calcDistances does with the histograms of the depths of rooms
+	static void selfConvolve(long *a, int n, long *result)
+	{
+		Workspace ws;
+		_selfConvolve(a, n, result, ws);
+	}
+	// As calcDist, without printing, but stops as soon as the result is
+	// known to exceed limit, and then returns a value larger than limit.
+	// The rows are counted a block at a time. As the counts only grow,
+	// the counts that already exceed the expected number give a lower
+	// bound of the result.
+	long calcDist(long limit)
+	{
+		int types[16];
+		for (int i = 0; i < 16; i++)
+			types[i] = 0;
+		long exp = _w * _h / 15;
+		int rows = (256 + _w - 1) / _w;
+		for (int j = 0; j < _h; j += rows)
+		{
+			_countTypes(j, j + rows < _h ? j + rows : _h, types);
+			long bound = 0;
+			for (int i = 1; i < 15; i++)
+				if (types[i] > exp)
+					bound += (types[i] - exp)*(types[i] - exp)*(types[i] - exp);
+			if (bound > limit)
+				return bound;
+		}
+		long result = 0;
+		for (int i = 1; i < 15; i++)
+		{
+			long d = exp - types[i];
+			if (d < 0)
+				d = -d;
+			result += d*d*d;
+		}
+		return result;
+	}
+	void dump()
+	{
+		for (int j = 0; j < _h; j++)
+		{
+			for (int i = 0; i < _w; i++)
+				printf("%c%c%c%c ", 
+						_hasWall(i, j, 0) ? ' ' : 'r',
+						_hasWall(i, j, 1) ? ' ' : 'b',
+						_hasWall(i, j, 2) ? ' ' : 'l',
+						_hasWall(i, j, 3) ? ' ' : 't');
+			printf("\n");
+		}
+	}
+
+	class iterator
+	{
+	public:
+		iterator(MazeT &maze, int i, int j, int d) : _maze(maze), _s_c(maze._cell(i, j)), _s_d(d), _i(i), _j(j), _c(_s_c), _d(d), _turn(0), _state(0) { next(); }
+		int i() { return _i; }
+		int j() { return _j; }
+		int d() { return _d; }
+		int turn() { return _turn; }
+		bool more() { return _state != 0; }
+		void next()
+		{
+			MAZE_COUNT(_maze, iterator_steps, 1);
+			static const int di[4] = { 1, 0, -1, 0 };
+			switch(_state) {
+				case 0: goto L0;
+				case 1: goto L1;
+				case 2: goto L2;
+				case 3: goto L3;
+				case 4: goto L4;
+			}
+			
+			L0:
+			do
+			{
+				if (_maze._wallAt(_c, _d-1) == s_passage)
+				{
+					_turn = -1;
+					_state = 1; return; L1:
+					_d = (_d+3)%4;
+					goto Lmove;
+				}
+				else
+				{
+					_turn = 2;
+					_state = 2; return; L2:;
+					if (_maze._wallAt(_c, _d) == s_passage)
+					{
+						Lmove:
+						_i += di[_d];
+						_j += di[(_d+3)%4];
+						_c = _maze._layout.next(_c, _d);
+						_turn = 0;
+						_state = 3; return; L3:;
+					}
+					else
+					{
+						_turn = 1;
+						_state = 4; return; L4:;
+						_d = (_d+1)%4;
+					}
+				}
+			}
+			while (_c != _s_c || _d != _s_d);
+			_state = 0;
+		}
+	private:
+		MazeT &_maze;
+		int _s_c, _s_d;
+		int _i, _j, _c, _d;
+		int _turn;
+		int _state;
+	};
+
+	// Index on the passages of a maze that answers distance and path
+	// queries between rooms, numbered i + w*j. It is built from a
+	// depth-first traversal: the room where the paths from two rooms
+	// to the root meet is the parent of the shallowest room between them
+	// in preorder. Its position is found in constant time with a bit
+	// mask of the stack of shallower rooms within the last 32 positions,
+	// and a sparse table on the shallowest position of each block of 32.
+	// The maze should be a tree, and should not change while the index
+	// is used. Queries only read the index, so several threads can use it.
+	class path_index
+	{
+	public:
+		path_index(MazeT &maze) : _n(maze._w*maze._h), _nr_blocks((_n + 31) / 32)
+		{
+			_parent = new int[_n];
+			_depth = new int[_n];
+			_pos = new int[_n];
+			_tree = new int[_n];
+			_order = new int[_n];
+			_order_depth = new int[_n];
+			_mask = new uint32_t[_n];
+			for (int r = 0; r < _n; r++)
+				_pos[r] = -1;
+			int nr = 0;
+			int *stack = new int[_n];
+			for (int root = 0; root < _n; root++)
+				if (_pos[root] == -1)
+				{
+					int sp = 0;
+					stack[sp++] = root;
+					_parent[root] = -1;
+					_depth[root] = 0;
+					while (sp > 0)
+					{
+						int r = stack[--sp];
+						_tree[r] = root;
+						_pos[r] = nr;
+						_order[nr++] = r;
+						for (int d = 0; d < 4; d++)
+							if (!maze._hasWall(r % maze._w, r / maze._w, d))
+							{
+								int s = maze._neighbour(r, d);
+								if (s != _parent[r])
+								{
+									_parent[s] = r;
+									_depth[s] = _depth[r] + 1;
+									stack[sp++] = s;
+								}
+							}
+					}
+				}
+			delete[] stack;
+			for (int p = 0; p < _n; p++)
+				_order_depth[p] = _depth[_order[p]];
+			// Bit k of _mask[p] is set when the room at position p-k is
+			// shallower than all rooms after it up to position p
+			uint32_t mask = 0;
+			for (int p = 0; p < _n; p++)
+			{
+				mask <<= 1;
+				while (mask != 0 && _order_depth[p - __builtin_ctz(mask)] >= _order_depth[p])
+					mask &= mask - 1;
+				mask |= 1;
+				_mask[p] = mask;
+			}
+			// Level k of _blocks holds for each block the shallowest
+			// position of the 2^k blocks starting with it
+			_levels = 1;
+			while ((1 << _levels) < _nr_blocks)
+				_levels++;
+			_blocks = new int[(long)_levels*_nr_blocks];
+			for (int b = 0; b < _nr_blocks; b++)
+			{
+				int last = b*32 + 31 < _n ? b*32 + 31 : _n - 1;
+				_blocks[b] = _small(last, last - b*32 + 1);
+			}
+			for (int k = 1; k < _levels; k++)
+			{
+				int *prev = _blocks + (long)(k-1)*_nr_blocks;
+				int *cur = _blocks + (long)k*_nr_blocks;
+				int half = 1 << (k-1);
+				for (int b = 0; b + 2*half <= _nr_blocks; b++)
+					cur[b] = _shallower(prev[b], prev[b + half]);
+			}
+		}
+		~path_index()
+		{
+			delete[] _parent;
+			delete[] _depth;
+			delete[] _pos;
+			delete[] _tree;
+			delete[] _order;
+			delete[] _order_depth;
+			delete[] _mask;
+			delete[] _blocks;
+		}
+		// Returns the room where the paths from a and b to the root of
+		// the traversal meet, or -1 if they are not connected
+		int meet(int a, int b)
+		{
+			if (_tree[a] != _tree[b])
+				return -1;
+			if (a == b)
+				return a;
+			int l = _pos[a];
+			int r = _pos[b];
+			if (l > r)
+			{
+				int t = l;
+				l = r;
+				r = t;
+			}
+			return _parent[_order[_shallowest(l + 1, r)]];
+		}
+		// Returns the number of passages between a and b, or -1 if they
+		// are not connected
+		int distance(int a, int b)
+		{
+			int m = meet(a, b);
+			return m == -1 ? -1 : _depth[a] + _depth[b] - 2*_depth[m];
+		}
+		void distances(const int *a, const int *b, int n, int *result)
+		{
+			for (int q = 0; q < n; q++)
+				result[q] = distance(a[q], b[q]);
+		}
+		// Stores the rooms on the path from a to b in rooms, and returns
+		// their number (the distance plus one), or zero if there is none
+		int path(int a, int b, int *rooms)
+		{
+			int m = meet(a, b);
+			if (m == -1)
+				return 0;
+			int n = 0;
+			for (int r = a; r != m; r = _parent[r])
+				rooms[n++] = r;
+			rooms[n++] = m;
+			int len = n + _depth[b] - _depth[m];
+			for (int r = b, q = len-1; r != m; r = _parent[r], q--)
+				rooms[q] = r;
+			return len;
+		}
+	private:
+		int _shallower(int p, int q) { return _order_depth[p] <= _order_depth[q] ? p : q; }
+		// The shallowest of the size (at most 32) positions up to p
+		int _small(int p, int size)
+		{
+			uint32_t mask = size == 32 ? _mask[p] : _mask[p] & ((1u << size) - 1);
+			return p - (31 - __builtin_clz(mask));
+		}
+		// The shallowest of the positions from l to r
+		int _shallowest(int l, int r)
+		{
+			if (r - l < 32)
+				return _small(r, r - l + 1);
+			int x = _shallower(_small(l + 31, 32), _small(r, 32));
+			int bl = l / 32 + 1;
+			int br = r / 32 - 1;
+			if (bl <= br)
+			{
+				int k = 31 - __builtin_clz(br - bl + 1);
+				int *level = _blocks + (long)k*_nr_blocks;
+				x = _shallower(x, _shallower(level[bl], level[br - (1 << k) + 1]));
+			}
+			return x;
+		}
+		int _n;
+		int _nr_blocks;
+		int *_parent;
+		int *_depth;
+		int *_pos;
+		int *_tree;
+		int *_order;
+		int *_order_depth;
+		uint32_t *_mask;
+		int _levels;
+		int *_blocks;
+	};
+
+	void removeCrosses()
+	{
+		// The passages are kept as a spanning tree in Euler tour trees,
+		// with as key of each room its distance to the top left corner,
+		// and for rooms at the same distance, its number of passages.
+		// Closing a wall of a cross splits the tree in two parts, which
+		// are joined again by opening the top or left wall of the room
+		// with the smallest key in the part without the top left corner.
+		// When that is not possible, because of hard walls, any wall
+		// between the parts is opened, found by scanning the smaller part.
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		EulerTourTrees trees(_w*_h, _rng.next(), &ws);
+		int nr_edges = (_w-1)*_h + _w*(_h-1);
+		int *tree_edge = ws.alloc<int>(nr_edges);
+		int *rooms = ws.alloc<int>(_w*_h);
+		_buildTrees(trees, tree_edge);
+
+		for (int k = _w + _h - 2; k > 0; k--)
+			for (int i = 0, j = k; i < _w; i++, j--)
+				if (0 <= j && j < _h)
+				{
+					int r = i + _w*j;
+					int side = _rand(2) == 0;
+					for (int p = 0; p < 4 && _nrWalls(i, j) == 0; p++, side = 1-side)
+					{
+						//printf("Cross at %d, %d %d\n", i, j, p);
+						MAZE_COUNT(*this, crosses_found, 1);
+						int e = _edgeOf(i, j, side == 0 ? 3 : 2);
+						if (!_closeCross(trees, tree_edge, e))
+							break;
+						int best = trees.minVertex(p < 2 ? r : _neighbour(r, side == 0 ? 3 : 2));
+						int best_i = best % _w;
+						int best_j = best / _w;
+						bool l = best_i + best_j > 0 && best_i + best_j < k && _wall(best_i, best_j, 2) == s_wall;
+						bool t = best_i + best_j > 0 && best_i + best_j < k && _wall(best_i, best_j, 3) == s_wall;
+						if (!l && !t)
+							_openCross(trees, tree_edge, e);
+						else if (l && t ? _rand(2) == 0 : t)
+							_openCross(trees, tree_edge, _edgeOf(best_i, best_j, 3));
+						else
+							_openCross(trees, tree_edge, _edgeOf(best_i, best_j, 2));
+					}
+					for (int p = 0; p < 2 && _nrWalls(i, j) == 0; p++, side = 1-side)
+					{
+						MAZE_COUNT(*this, crosses_found, 1);
+						MAZE_COUNT(*this, cross_scans, 1);
+						int d = side == 0 ? 3 : 2;
+						int e = _edgeOf(i, j, d);
+						if (!_closeCross(trees, tree_edge, e))
+							break;
+						int s = trees.size(r) <= trees.size(_neighbour(r, d)) ? r : _neighbour(r, d);
+						int n = trees.vertices(s, rooms);
+						bool resolved = false;
+						for (int q = 0; q < n && !resolved; q++)
+							for (int d = 0; d < 4 && !resolved; d++)
+							{
+								int a = rooms[q];
+								if (   _wall(a % _w, a / _w, d) == s_wall && _edgeOf(a % _w, a / _w, d) != e
+								    && !trees.connected(a, _neighbour(a, d)))
+								{
+									_openCross(trees, tree_edge, _edgeOf(a % _w, a / _w, d));
+									resolved = true;
+								}
+							}
+						if (!resolved)
+							_openCross(trees, tree_edge, e);
+					}
+				}
+		ws.release(mark);
+	}
+	
+	bool stampStreched(MazeT &pattern)
+	{
+		if (pattern._w > _w || pattern._h > _h)
+			return false;
+
+		for (int i = 0; i < pattern._w-1; i++)
+			for (int j = 0; j < pattern._h; j++)
+				if (pattern.right(i, j) >= s_wall)
+				{
+					int l = ((i+1) * _w)/pattern._w - 1;
+					int t = (j * _h)/pattern._h;
+					int b = ((j+1) * _h)/pattern._h;
+					for (int k = t; k < b; k++)
+						right(l, k) = s_hard_wall;
+				}
+		for (int i = 0; i < pattern._w; i++)
+			for (int j = 0; j < pattern._h-1; j++)
+				if (pattern.bottom(i, j) >= s_wall)
+				{
+					int l = (i * _w)/pattern._w;
+					int r = ((i+1) * _w)/pattern._w;
+					int b = ((j+1) * _h)/pattern._h - 1;
+					for (int k = l; k < r; k++)
+						bottom(k, b) = s_hard_wall;
+				}
+		return true;
+	}
+
+	bool stampAt(MazeT &pattern, int x, int y)
+	{
+		if (x < 0 || x + pattern._w > _w || y < 0 || y + pattern._h > _h)
+			return false;
+		for (int i = 0; i < pattern._w-1; i++)
+			for (int j = 0; j < pattern._h; j++)
+				right(x + i, y + j) = pattern.right(i, j) >= s_wall ? s_hard_wall : s_passage;
+		for (int i = 0; i < pattern._w; i++)
+			for (int j = 0; j < pattern._h-1; j++)
+				bottom(x + i, y + j) = pattern.bottom(i, j) >= s_wall ? s_hard_wall : s_passage;
+		return true;
+	}
+
+	// Determines the height of each room: the round in which the room is
+	// removed when repeatedly removing all rooms with one passage to the
+	// rooms that remain, raised such that the heights of rooms with a
+	// passage between them differ at most one
+	void calcHeights(int *height)
+	{
+		int n = _w*_h;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int *degree = ws.alloc<int>(n);
+		int *queue = ws.alloc<int>(n);
+		// queue[first..last) holds the candidates for the current round,
+		// which are those rooms that got one passage left
+		int first = 0;
+		int last = 0;
+		for (int r = 0; r < n; r++)
+		{
+			height[r] = n;
+			degree[r] = 4 - _nrWalls(r % _w, r / _w);
+			if (degree[r] == 1)
+				queue[last++] = r;
+		}
+		int h;
+		for (h = 1; first < last; h++)
+		{
+			// Rooms that lost their last passage are never removed
+			int end = first;
+			for (int q = first; q < last; q++)
+				if (degree[queue[q]] == 1)
+				{
+					height[queue[q]] = h;
+					queue[end++] = queue[q];
+				}
+			if (end == first)
+				break;
+			last = end;
+			for (int q = first; q < end; q++)
+				for (int d = 0; d < 4; d++)
+					if (!_hasWall(queue[q] % _w, queue[q] / _w, d))
+					{
+						int r = _neighbour(queue[q], d);
+						if (height[r] == n && --degree[r] == 1)
+							queue[last++] = r;
+					}
+			first = end;
+		}
+		// The rooms that remain get the height after the last round
+		int max = 0;
+		for (int r = 0; r < n; r++)
+		{
+			if (height[r] > h + 1)
+				height[r] = h + 1;
+			if (height[r] > max)
+				max = height[r];
+		}
+
+		// Raise the heights from the highest rooms outward, one level at
+		// a time. order holds the rooms sorted on height, with those of
+		// height l ending at end[l], and queue the rooms that are raised.
+		int *end = ws.alloc<int>(max + 1);
+		int *order = degree;
+		for (int l = 0; l <= max; l++)
+			end[l] = 0;
+		for (int r = 0; r < n; r++)
+			end[height[r]]++;
+		for (int l = 1; l <= max; l++)
+			end[l] += end[l-1];
+		for (int r = n - 1; r >= 0; r--)
+			order[--end[height[r]]] = r;
+		for (int l = 0; l < max; l++)
+			end[l] = end[l+1];
+		end[max] = n;
+		first = last = 0;
+		for (int l = max; l > 1; l--)
+		{
+			// The rooms of height l are those with that height from the
+			// start, followed by those raised to it in the previous step
+			int nr_start = end[l] - end[l-1];
+			int raised = last;
+			for (int q = 0; q < nr_start + raised - first; q++)
+			{
+				int r = q < nr_start ? order[end[l-1] + q] : queue[first + q - nr_start];
+				if (height[r] != l)
+					continue;
+				for (int d = 0; d < 4; d++)
+					if (!_hasWall(r % _w, r / _w, d))
+					{
+						int s = _neighbour(r, d);
+						if (height[s] < l - 1)
+						{
+							height[s] = l - 1;
+							queue[last++] = s;
+						}
+					}
+			}
+			first = raised;
+		}
+		ws.release(mark);
+	}
+
+	// Copies the passages of maze between the rooms that are not among
+	// the lowest (1 - factor) part of the rooms, by height. The heights
+	// of maze can be given, as calculated by calcHeights.
+	bool fillPartial(MazeT &maze, double factor, const int *heights = 0)
+	{
+		if (_w != maze._w || _h != maze._h)
+			return false;
+		
+		int n = _w*_h;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		if (heights == 0)
+		{
+			int *height = ws.alloc<int>(n);
+			maze.calcHeights(height);
+			heights = height;
+		}
+		// Determine the heights that should be included
+		int *count = ws.alloc<int>(n + 1);
+		for (int h = 0; h <= n; h++)
+			count[h] = 0;
+		for (int r = 0; r < n; r++)
+			count[heights[r]]++;
+		int nr_excluded = (double)(_w*_h) * (1 - factor);
+		int nr = 0;
+		int h;
+		for (h = 1; nr < nr_excluded && h <= n; h++)
+			nr += count[h];
+		// copy the parts above that height
+		for (int i = 0; i < _w-1; i++)
+			for (int j = 0; j < _h; j++)
+				if (maze.right(i, j) == s_passage && heights[i + _w*j] >= h && heights[(i+1) + _w*j] >= h)
+					right(i, j) = s_passage;
+		for (int i = 0; i < _w; i++)
+			for (int j = 0; j < _h-1; j++)
+				if (maze.bottom(i, j) == s_passage && heights[i + _w*j] >= h && heights[i + _w*(j+1)] >= h)
+					bottom(i, j) = s_passage;
+
+		ws.release(mark);
+		return true;
+	}
+
+	bool check()
+	{
+		int count = 0;
+		for (iterator it(*this, 0, 0, 0); it.more(); it.next())
+			if (it.turn() == 0)
+				count++;
+		//printf("%d == %d\n", count, 2*(_w*_h - 1));
+		return count == 2*(_w*_h - 1);
+	}
+	
+	void svg(const char *filename, double wall_width, double hall_width, const char *color, double stroke_width, bool with_border)
+	{
+		FILE *f = fopen(filename, "wt");
+		if (f == 0)
+		{
+			fprintf(stderr, "Cannot open file '%s' for writing\n", filename);
+			return;
+		}
+		fprintf(f, "<svg width=\"%.0f\" height=\"%.0f\" xmlns=\"http://www.w3.org/2000/svg\">\n",
+				(wall_width+hall_width)*(_w+1), (wall_width+hall_width)*(_h+1));
+		if (with_border)
+		{
+			fprintf(f, "<path d=\"M%.2lf %.2lf\n", hall_width/2, hall_width/2);
+			fprintf(f, "L %.2lf %.2lf\n", hall_width/2 + (_w+1)*wall_width + _w*hall_width, hall_width/2);
+			fprintf(f, "L %.2lf %.2lf\n", hall_width/2 + (_w+1)*wall_width + _w*hall_width, hall_width/2 + (_h+1)*wall_width + _h*hall_width);
+			fprintf(f, "L %.2lf %.2lf\n", hall_width/2, hall_width/2 + (_h+1)*wall_width + _h*hall_width);
+			fprintf(f, "Z\" stroke=\"%s\" stroke-width=\"%.2lf\" fill-opacity=\"0.0\"/>\n", color, stroke_width);
+		}
+		// Find first cell with not only walls
+		int i = 0;
+		int j = 0;
+		while (j < _h && _nrWalls(i, j) == 4)
+		{
+			if (++i == _w)
+			{
+				i = 0;
+				j++;
+			}
+		}
+		fprintf(f, "<path d=\"M%.2lf %.2lf\n",
+			(hall_width + wall_width)*(i+1) - hall_width/2,
+			(hall_width + wall_width)*(j+1) - hall_width/2);
+		for (iterator it(*this, i, j, 0); it.more(); it.next())
+		{
+			if (it.turn() == -1) 
+				fprintf(f, "L %.2lf %.2lf\n",
+					 (hall_width + wall_width)*(it.i()+1) + hall_width/2*((it.d() == 0 || it.d() == 3) ? -1 : 1),
+					 (hall_width + wall_width)*(it.j()+1) + hall_width/2*((it.d() == 0 || it.d() == 1) ? -1 : 1));
+			if (it.turn() == 1) 
+				fprintf(f, "L %.2lf %.2lf\n",
+					 (hall_width + wall_width)*(it.i()+1) + hall_width/2*((it.d() == 2 || it.d() == 3) ? -1 : 1),
+					 (hall_width + wall_width)*(it.j()+1) + hall_width/2*((it.d() == 0 || it.d() == 3) ? -1 : 1));
+		}
+		fprintf(f, "\" stroke=\"%s\" stroke-width=\"%.2lf\" fill-opacity=\"0.0\"/></svg>\n", color, stroke_width);
+		fclose(f);
+	}
+
+	// Writes the maze in the format read by MazeFile
+	bool save(const char *filename)
+	{
+		if (!std::is_same<Layout, RowLayout>::value)
+		{
+			// The file holds the planes in the row layout
+			MazeT<Plane, Rng, RowLayout> row(_w, _h, _seed);
+			for (int i = 0; i < _w; i++)
+				for (int j = 0; j < _h; j++)
+				{
+					if (i < _w-1)
+						row.right(i, j) = right(i, j);
+					if (j < _h-1)
+						row.bottom(i, j) = bottom(i, j);
+				}
+			row._algorithm = _algorithm;
+			return row.save(filename);
+		}
+		FILE *f = fopen(filename, "wb");
+		if (f == 0)
+		{
+			fprintf(stderr, "Cannot open file '%s' for writing\n", filename);
+			return false;
+		}
+		MazeFileHeader header;
+		memcpy(header.magic, "MAZE", 4);
+		header.byte_order = 0x01020304;
+		header.version = 1;
+		header.w = _w;
+		header.h = _h;
+		header.algorithm = _algorithm;
+		header.seed = _seed;
+		bool ok =    fwrite(&header, sizeof(header), 1, f) == 1
+		          && fwrite(_planes[0].words(), sizeof(unsigned), _planes[0].nrWords(), f) == (size_t)_planes[0].nrWords()
+		          && fwrite(_planes[1].words(), sizeof(unsigned), _planes[1].nrWords(), f) == (size_t)_planes[1].nrWords();
+		if (fclose(f) != 0)
+			ok = false;
+		if (!ok)
+			fprintf(stderr, "Cannot write file '%s'\n", filename);
+		return ok;
+	}
+private:
+	// The edges are stored per cell of a grid with a ring of cells around
+	// the maze: room (i,j) is cell (i+1,j+1), which _layout maps on an
+	// index. _planes[0] holds the traversal to the right of each cell and
+	// _planes[1] the one below it. The traversals of the ring are hard
+	// walls, such that the traversals of the rooms along the outside need
+	// no special case.
+	int _cell(int i, int j) { return _layout.cell(i+1, j+1); }
+	void _initOffsets()
+	{
+		_layout.init(_w + 2, _h + 2);
+	}
+	ref _wallAt(int c, int d)
+	{
+		d &= 3;
+		return _planes[d & 1][_layout.edgeCell(c, d)];
+	}
+	ref _wall(int i, int j, int d)
+	{
+		return _wallAt(_cell(i, j), d);
+	}
+	bool _hasWall(int i, int j, int d)
+	{
+		return _wall(i, j, d) != s_passage;
+	}
+	int _nrWalls(int i, int j)
+	{
+		int c = 0;
+		for (int d = 0; d < 4; d++)
+			if (_hasWall(i, j, d))
+				c++;
+		return c;
+	}
+	static void _harden(ref edge)
+	{
+		if (edge == s_wall)
+			edge = s_hard_wall;
+	}
+	void _wilsonRing(int x0, int y0, int w0, int h0, int x, int y, int w, int h)
+	{
+		// Wilson's algorithm on the rooms in the rectangle (x0, y0, w0, h0)
+		// outside the rectangle (x, y, w, h), whose rooms are included.
+		// Walks end at the rooms along the border of the inner rectangle,
+		// so only these are marked as included (4). The cells around the
+		// outer rectangle are marked as blocked (5), such that the walks
+		// stay inside it. The state of other cells is not initialized.
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int* state = ws.alloc<int>(nrCells());
+		int* rooms = ws.alloc<int>(w0*h0 - w*h);
+		int* pos = ws.alloc<int>(nrCells());
+		int to_go = 0;
+		for (int i = x0 - 1; i <= x0 + w0; i++)
+			state[_cell(i, y0 - 1)] = state[_cell(i, y0 + h0)] = 5;
+		for (int j = y0; j < y0 + h0; j++)
+			state[_cell(x0 - 1, j)] = state[_cell(x0 + w0, j)] = 5;
+		for (int j = y; j < y + h; j++)
+			for (int i = x; i < x + w; i += (j == y || j == y + h-1 || i == x + w-1) ? 1 : w-1)
+				state[_cell(i, j)] = 4;
+		for (int j = y0; j < y0 + h0; j++)
+			for (int i = x0; i < x0 + w0; i++)
+				if (i == x && j >= y && j < y + h && w > 0)
+					i += w-1;
+				else
+				{
+					int c = _cell(i, j);
+					state[c] = 0;
+					pos[c] = to_go;
+					rooms[to_go++] = c;
+				}
+		if (w*h == 0)
+		{
+			int c = rooms[_rand(to_go)];
+			state[c] = 4;
+			_include(c, rooms, pos, to_go);
+		}
+		while (to_go > 0)
+		{
+			int s = rooms[_rand(to_go)];
+			int c = s;
+			MAZE_COUNT(*this, wilson_walks, 1);
+			while (state[c] != 4)
+			{
+				int d = _rand(4);
+				int next = _layout.next(c, d);
+				if (state[next] != 5 && _wallAt(c, d) != s_hard_wall)
+				{
+					MAZE_COUNT(*this, wilson_walk_steps, 1);
+					MAZE_COUNT(*this, wilson_erased, 1);
+					state[c] = d;
+					c = next;
+				}
+			}
+			c = s;
+			while (state[c] != 4)
+			{
+				int d = state[c];
+				state[c] = 4;
+				_include(c, rooms, pos, to_go);
+				MAZE_COUNT(*this, wilson_erased, -1);
+				_wallAt(c, d) = s_passage;
+				c = _layout.next(c, d);
+			}
+		}
+		ws.release(mark);
+	}
+	void _include(int r, int *rooms, int *pos, int &to_go)
+	{
+		// Remove room r from rooms by moving the last one in its place
+		int last = rooms[--to_go];
+		rooms[pos[r]] = last;
+		pos[last] = pos[r];
+	}
+	int _rand(int n) { return _rng.below(n); }
+	void _tileWorker(int tile_w, int tile_h, algorithm alg, uint64_t seed, int *nr_parts, int **border, std::atomic<int> *next, std::mutex *copy_mutex)
+	{
+		int nr_tx = (_w + tile_w - 1) / tile_w;
+		int nr_tiles = nr_tx * ((_h + tile_h - 1) / tile_h);
+		for (int t = (*next)++; t < nr_tiles; t = (*next)++)
+		{
+			int x = (t % nr_tx) * tile_w;
+			int y = (t / nr_tx) * tile_h;
+			int w = _span(x, tile_w, _w);
+			int h = _span(y, tile_h, _h);
+			MazeT tile(w, h, seed + t);
+			{
+				// The hard walls share words of the planes with the edges of
+				// the tiles that other threads copy back, so are read under
+				// the same lock
+				std::lock_guard<std::mutex> lock(*copy_mutex);
+				for (int i = 0; i < w-1; i++)
+					for (int j = 0; j < h; j++)
+						if (right(x + i, y + j) == s_hard_wall)
+							tile.right(i, j) = s_hard_wall;
+				for (int i = 0; i < w; i++)
+					for (int j = 0; j < h-1; j++)
+						if (bottom(x + i, y + j) == s_hard_wall)
+							tile.bottom(i, j) = s_hard_wall;
+			}
+			tile.generate(alg);
+
+			int *label = new int[w*h];
+			int *queue = new int[w*h];
+			nr_parts[t] = tile._components(label, queue, s_wall);
+			border[t] = new int[2*(w+h)];
+			for (int j = 0; j < h; j++)
+			{
+				border[t][j] = label[w*j];
+				border[t][h + j] = label[w-1 + w*j];
+			}
+			for (int i = 0; i < w; i++)
+			{
+				border[t][2*h + i] = label[i];
+				border[t][2*h + w + i] = label[i + w*(h-1)];
+			}
+			delete[] label;
+			delete[] queue;
+
+			// Neighbouring tiles share words of the planes, so the tiles
+			// are copied back one at a time
+			std::lock_guard<std::mutex> lock(*copy_mutex);
+#ifdef MAZE_STATS
+			_counters.merge(tile._counters);
+#endif
+			for (int i = 0; i < w-1; i++)
+				for (int j = 0; j < h; j++)
+					right(x + i, y + j) = tile.right(i, j);
+			for (int i = 0; i < w; i++)
+				for (int j = 0; j < h-1; j++)
+					bottom(x + i, y + j) = tile.bottom(i, j);
+		}
+	}
+	// The size of the tile starting at start, the last one can be smaller
+	static int _span(int start, int tile, int total) { return start + tile <= total ? tile : total - start; }
+	// Key of a room for removeCrosses: the rooms nearest to the top left
+	// corner come first, and of those the ones with the most walls
+	int _crossKey(int r)
+	{
+		return 5*(r % _w + r / _w) + 4 - _nrWalls(r % _w, r / _w);
+	}
+	void _buildTrees(EulerTourTrees &trees, int *tree_edge)
+	{
+		// Builds the trees from the Euler tours of a depth-first search
+		// over the passages. Passages that close a loop are not part of
+		// the trees, and are marked with -1 in tree_edge like walls.
+		int nr_edges = (_w-1)*_h + _w*(_h-1);
+		for (int k = 0; k < nr_edges; k++)
+			tree_edge[k] = -1;
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		int *tour = ws.alloc<int>(3*_w*_h);
+		int *stack = ws.alloc<int>(3*_w*_h);
+		int *dir = ws.alloc<int>(_w*_h);
+		bool *visited = ws.alloc<bool>(_w*_h);
+		for (int r = 0; r < _w*_h; r++)
+		{
+			trees.setKey(r, _crossKey(r));
+			visited[r] = false;
+		}
+		for (int root = 0; root < _w*_h; root++)
+			if (!visited[root])
+			{
+				// stack holds the rooms on the current path, and dir the
+				// next direction to try for each of them
+				int len = 0;
+				int sp = 0;
+				stack[sp++] = root;
+				dir[root] = 0;
+				visited[root] = true;
+				tour[len++] = root;
+				while (sp > 0)
+				{
+					int r = stack[sp-1];
+					if (dir[r] == 4)
+					{
+						if (--sp > 0)
+						{
+							int k = _edgeOf(stack[sp-1] % _w, stack[sp-1] / _w, dir[stack[sp-1]] - 1);
+							tour[len++] = trees.edgeNode(tree_edge[k], 1);
+						}
+						continue;
+					}
+					int d = dir[r]++;
+					if (_hasWall(r % _w, r / _w, d))
+						continue;
+					int n = _neighbour(r, d);
+					if (visited[n])
+						continue;
+					int k = _edgeOf(r % _w, r / _w, d);
+					tree_edge[k] = trees.newEdge();
+					tour[len++] = trees.edgeNode(tree_edge[k], 0);
+					tour[len++] = n;
+					visited[n] = true;
+					dir[n] = 0;
+					stack[sp++] = n;
+				}
+				trees.build(tour, len, stack);
+			}
+		ws.release(mark);
+	}
+	void _updateCrossKeys(EulerTourTrees &trees, int k)
+	{
+		int a, b;
+		_rooms(k, a, b);
+		trees.setKey(a, _crossKey(a));
+		trees.setKey(b, _crossKey(b));
+	}
+	// Closes traversal k of a cross and returns whether this split the
+	// maze in two parts
+	bool _closeCross(EulerTourTrees &trees, int *tree_edge, int k)
+	{
+		_edge(k) = s_wall;
+		_updateCrossKeys(trees, k);
+		if (tree_edge[k] == -1)
+			return false;
+		trees.cut(tree_edge[k]);
+		tree_edge[k] = -1;
+		return true;
+	}
+	// Opens traversal k, which joins two parts of the maze
+	void _openCross(EulerTourTrees &trees, int *tree_edge, int k)
+	{
+		int a, b;
+		_rooms(k, a, b);
+		_edge(k) = s_passage;
+		_updateCrossKeys(trees, k);
+		tree_edge[k] = trees.link(a, b);
+	}
+	int _neighbour(int r, int d)
+	{
+		return r + (d == 0 ? 1 : d == 1 ? _w : d == 2 ? -1 : -_w);
+	}
+	int _components(int *label, int *queue, state limit)
+	{
+		// Labels each room with the number of the part it belongs to, where
+		// only traversals with a state below limit can be passed. Returns
+		// the number of parts.
+		for (int r = 0; r < _w*_h; r++)
+			label[r] = -1;
+		int nr = 0;
+		for (int r = 0; r < _w*_h; r++)
+			if (label[r] == -1)
+			{
+				int n = 0;
+				queue[n++] = r;
+				label[r] = nr;
+				for (int k = 0; k < n; k++)
+				{
+					int c = queue[k];
+					for (int d = 0; d < 4; d++)
+						if (_wall(c % _w, c / _w, d) < limit && label[_neighbour(c, d)] == -1)
+						{
+							label[_neighbour(c, d)] = nr;
+							queue[n++] = _neighbour(c, d);
+						}
+				}
+				nr++;
+			}
+		return nr;
+	}
+	void _recurse(int c, char *from)
+	{
+		// Depth-first search with the current path kept in from[]
+		// instead of on the call stack. At each room, one of the
+		// unvisited rooms that can be reached is selected at random,
+		// and when there are none, the search returns to the room it
+		// came from. The rooms behind hard walls, which include the
+		// ring around the maze, are never visited.
+		from[c] = 5;
+		for (;;)
+		{
+			int dirs[4];
+			int n = 0;
+			for (int d = 0; d < 4; d++)
+				if (_wallAt(c, d) != s_hard_wall && from[_layout.next(c, d)] == 0)
+					dirs[n++] = d;
+			int d;
+			if (n == 0)
+			{
+				if (from[c] == 5)
+					break;
+				d = from[c] - 1;
+			}
+			else
+			{
+				d = dirs[_rand(n)];
+				_wallAt(c, d) = s_passage;
+			}
+			c = _layout.next(c, d);
+			if (n > 0)
+				from[c] = 1 + (d+2)%4;
+			MAZE_COUNT(*this, recurse_depth, n > 0 ? 1 : -1);
+			MAZE_COUNT_MAX(*this, recurse_max_depth, _counters.recurse_depth);
+		}
+	}
+	
+	// Divisions and squares of at least this many rooms give their parts
+	// a random stream of their own, which can be generated by another thread
+	static const int task_grain = 4096;
+	void _split(int i, int j, int w, int h, Rng &rng, TaskPool *pool, int worker)
+	{
+		if (w == 1)
+		{
+			for (int k = 1; k < h; k++)
+				_open(_cell(i, j+k), 3, pool != 0);
+			return;
+		}
+		if (h == 1)
+		{
+			for (int k = 1; k < w; k++)
+				_open(_cell(i+k, j), 2, pool != 0);
+			return;
+		}
+		int i2 = i, j2 = j, w2 = w, h2 = h;
+		if (w < h || (w == h && (rng.below(2) == 0)))
+		{
+			int h_r = h == 2 ? 1 :
+					  h <= 4 ? 1 + rng.below(h-1) :
+					  h <= 6 ? 2 + rng.below(h-3) :
+							   3 + rng.below(h-5);
+			int o = rng.below(w);
+			_open(_cell(i + o, j + h_r), 3, pool != 0);
+			h = h_r;
+			j2 += h_r;
+			h2 -= h_r;
+		}
+		else
+		{
+			int w_r = w == 2 ? 1 :
+					  w <= 4 ? 1 + rng.below(w-1) :
+					  w <= 6 ? 2 + rng.below(w-3) :
+							   3 + rng.below(w-5);
+			int o = rng.below(h);
+			_open(_cell(i + w_r, j + o), 2, pool != 0);
+			w = w_r;
+			i2 += w_r;
+			w2 -= w_r;
+		}
+		if (w*h + w2*h2 < task_grain)
+		{
+			_split(i, j, w, h, rng, pool, worker);
+			_split(i2, j2, w2, h2, rng, pool, worker);
+			return;
+		}
+		uint64_t seed1 = rng.next();
+		uint64_t seed2 = rng.next();
+		_splitTask(i, j, w, h, seed1, pool, worker);
+		_splitTask(i2, j2, w2, h2, seed2, pool, worker);
+	}
+	void _splitTask(int i, int j, int w, int h, uint64_t seed, TaskPool *pool, int worker)
+	{
+		if (pool == 0)
+		{
+			Rng rng(seed);
+			_split(i, j, w, h, rng, 0, 0);
+		}
+		else
+			pool->spawn(worker, [=](int worker) { Rng rng(seed); _split(i, j, w, h, rng, pool, worker); });
+	}
+	// Opens the traversal of cell c in direction d, atomically when
+	// other threads can write traversals in the same words
+	void _open(int c, int d, bool shared)
+	{
+		if (shared)
+			_planes[d & 1].open(_layout.edgeCell(c, d));
+		else
+			_wallAt(c, d) = s_passage;
+	}
+
+	void _fractal(int i, int j, int size, frac_type ft, int avoid_corner, Rng &rng, TaskPool *pool, int worker)
+	{
+		//printf("frac %d %d %d\n", i, j, size);
+		if (   i + size <= 0 || i - size >= _w
+		    || j + size <= 0 || j - size >= _h)
+		    return;
+		
+		bool shared = pool != 0;
+		int d = -1;
+		if (i <= 0)
+		{
+			if (j > 0 && j < _h)
+				_open(_cell(_left_range(i, size, ft, rng), j), 3, shared);
+		}
+		else if (i >= _w)
+		{
+			if (j > 0 && j < _h)
+				_open(_cell(_right_range(i, size, ft, rng), j), 3, shared);
+		}
+		else if (j <= 0)
+		{
+			_open(_cell(i, _bottom_range(j, size, ft, rng)), 2, shared);
+		}
+		else if (j >= _h)
+		{
+			_open(_cell(i, _top_range(j, size, ft, rng)), 2, shared);
+		}
+		else
+		{
+			switch (ft)
+			{
+				case frac_regular:
+				case frac_reverse:					d = 1; break;
+				case frac_random_orient_no_cross:   d = (avoid_corner + 3 + rng.below(2)) % 4; break;
+				case frac_random_orient:
+				case frac_reverse_random_orient_no_cross:
+				case frac_all_random:				d = rng.below(4); break;
+			}
+			if (d != 0) _open(_cell(_left_range(i, size, ft, rng), j), 3, shared);
+			if (d != 1) _open(_cell(i, _bottom_range(j, size, ft, rng)), 2, shared);
+			if (d != 2) _open(_cell(_right_range(i, size, ft, rng), j), 3, shared);
+			if (d != 3) _open(_cell(i, _top_range(j, size, ft, rng)), 2, shared);
+		}
+		
+		if (size == 1)
+			return;
+		size /= 2;
+		int ci[4] = { i + size, i + size, i - size, i - size };
+		int cj[4] = { j - size, j + size, j + size, j - size };
+		int avoid[4] = { avoid_corner == 0 ? 0 : (d == 1 || d == 2) ? 2 : -1,
+		                 avoid_corner == 1 ? 1 : (d == 2 || d == 3) ? 3 : -1,
+		                 avoid_corner == 2 ? 2 : (d == 3 || d == 0) ? 0 : -1,
+		                 avoid_corner == 3 ? 3 : (d == 0 || d == 1) ? 1 : -1 };
+		if (4*size*size < task_grain)
+		{
+			for (int q = 0; q < 4; q++)
+				_fractal(ci[q], cj[q], size, ft, avoid[q], rng, pool, worker);
+			return;
+		}
+		uint64_t seeds[4];
+		for (int q = 0; q < 4; q++)
+			seeds[q] = rng.next();
+		for (int q = 0; q < 4; q++)
+		{
+			int qi = ci[q], qj = cj[q], qa = avoid[q];
+			uint64_t seed = seeds[q];
+			if (pool == 0)
+			{
+				Rng q_rng(seed);
+				_fractal(qi, qj, size, ft, qa, q_rng, 0, 0);
+			}
+			else
+				pool->spawn(worker, [=](int worker) { Rng q_rng(seed); _fractal(qi, qj, size, ft, qa, q_rng, pool, worker); });
+		}
+	}
+	int _min(int a, int b) { return a < b ? a : b; }
+	int _left_range(int i, int size, frac_type ft, Rng &rng)
+	{
+		int min = i < 0 ? 0 : i;
+		int max = (i + size < _w ? i + size : _w) - 1;
+		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return max;
+		if (ft != frac_all_random) return min;
+		return min + (min < max ? rng.below(max+1 - min) : 0);
+	}
+	int _right_range(int i, int size, frac_type ft, Rng &rng)
+	{
+		int max = (i > _w ? _w : i) - 1;
+		int min = i - size > 0 ? i - size : 0;
+		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return min;
+		if (ft != frac_all_random) return max;
+		return min + (min < max ? rng.below(max+1 - min) : 0);
+	}
+	int _bottom_range(int j, int size, frac_type ft, Rng &rng)
+	{
+		int min = j < 0 ? 0 : j;
+		int max = (j + size < _h ? j + size : _h) - 1;
+		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return max;
+		if (ft != frac_all_random) return min;
+		return min + (min < max ? rng.below(max+1 - min) : 0);
+	}
+	int _top_range(int j, int size, frac_type ft, Rng &rng)
+	{
+		int max = (j < _h ? j : _h) - 1;
+		int min = j - size < 0 ? 0 : j - size;
+		if (ft == frac_reverse || ft == frac_reverse_random_orient_no_cross) return min;
+		if (ft != frac_all_random) return max;
+		return min + (min < max ? rng.below(max+1 - min) : 0);
+	}
+	int _fix()
+	{
+		// Turns the passages into a spanning tree in two phases. In the
+		// first phase, walls are grown from the outside and the existing
+		// walls: passages touching a corner with a wall are picked at
+		// random and turned into a wall when that closes a loop, which is
+		// when the two corners of the passage are not yet connected by
+		// walls. In the second phase, the walls are visited in a random
+		// order, turning those that connect two separate parts into
+		// passages. Returns the number of traversals that were changed.
+		int nr_vert = (_w-1)*_h;
+		int nr_edges = nr_vert + _w*(_h-1);
+		int cw = _w + 1;
+		MAZE_COUNT(*this, fix_calls, 1);
+		int nr_corners = cw*(_h+1);
+		Workspace &ws = _scratch();
+		long mark = ws.mark();
+		DisjointSets corners(nr_corners, &ws);
+		bool *touched = ws.alloc<bool>(nr_corners);
+		bool *queued = ws.alloc<bool>(nr_edges);
+		int *edges = ws.alloc<int>(nr_edges);
+		for (int c = 0; c < nr_corners; c++)
+			touched[c] = false;
+		for (int x = 0; x <= _w; x++)
+		{
+			touched[x] = touched[x + cw*_h] = true;
+			corners.join(0, x);
+			corners.join(0, x + cw*_h);
+		}
+		for (int y = 0; y <= _h; y++)
+		{
+			touched[cw*y] = touched[_w + cw*y] = true;
+			corners.join(0, cw*y);
+			corners.join(0, _w + cw*y);
+		}
+		for (int k = 0; k < nr_edges; k++)
+		{
+			queued[k] = false;
+			if (_edge(k) != s_passage)
+			{
+				int a, b;
+				_corners(k, a, b);
+				corners.join(a, b);
+				touched[a] = touched[b] = true;
+			}
+		}
+		int nr_frontier = 0;
+		for (int k = 0; k < nr_edges; k++)
+		{
+			int a, b;
+			_corners(k, a, b);
+			if (_edge(k) == s_passage && (touched[a] || touched[b]))
+			{
+				queued[k] = true;
+				edges[nr_frontier++] = k;
+			}
+		}
+		int flipped = 0;
+		while (nr_frontier > 0)
+		{
+			int r = _rand(nr_frontier);
+			int k = edges[r];
+			edges[r] = edges[--nr_frontier];
+			MAZE_COUNT(*this, fix_candidates, 1);
+			int a, b;
+			_corners(k, a, b);
+			if (corners.join(a, b))
+			{
+				_edge(k) = s_wall;
+				flipped++;
+				for (int p = 0; p < 2; p++, a = b)
+					if (!touched[a])
+					{
+						touched[a] = true;
+						int around[4];
+						int n = _cornerEdges(a, around);
+						for (int q = 0; q < n; q++)
+							if (!queued[around[q]] && _edge(around[q]) == s_passage)
+							{
+								queued[around[q]] = true;
+								edges[nr_frontier++] = around[q];
+							}
+					}
+			}
+		}
+
+		DisjointSets rooms(_w*_h, &ws);
+		int nr_walls = 0;
+		for (int k = 0; k < nr_edges; k++)
+		{
+			int a, b;
+			_rooms(k, a, b);
+			if (_edge(k) == s_passage)
+				rooms.join(a, b);
+			else if (_edge(k) == s_wall)
+				edges[nr_walls++] = k;
+		}
+		_shuffle(edges, nr_walls);
+		MAZE_COUNT(*this, fix_candidates, nr_walls);
+		for (int p = 0; p < nr_walls; p++)
+		{
+			int a, b;
+			_rooms(edges[p], a, b);
+			if (rooms.join(a, b))
+			{
+				_edge(edges[p]) = s_passage;
+				flipped++;
+			}
+		}
+		ws.release(mark);
+		MAZE_COUNT(*this, fix_flips, flipped);
+		return flipped;
+	}
+	// Edges are numbered with the vertical traversals first, followed by
+	// the horizontal traversals. Rooms are numbered i + _w*j and the
+	// corners between them x + (_w+1)*y.
+	ref _edge(int k)
+	{
+		int nr_vert = (_w-1)*_h;
+		return k < nr_vert ? right(k / _h, k % _h) : bottom((k - nr_vert) % _w, (k - nr_vert) / _w);
+	}
+	int _edgeOf(int i, int j, int d)
+	{
+		int nr_vert = (_w-1)*_h;
+		switch (d)
+		{
+			case 0: return _h*i + j;
+			case 1: return nr_vert + i + _w*j;
+			case 2: return _h*(i-1) + j;
+		}
+		return nr_vert + i + _w*(j-1);
+	}
+	void _rooms(int k, int &a, int &b)
+	{
+		int nr_vert = (_w-1)*_h;
+		if (k < nr_vert)
+		{
+			a = k / _h + _w*(k % _h);
+			b = a + 1;
+		}
+		else
+		{
+			a = k - nr_vert;
+			b = a + _w;
+		}
+	}
+	void _corners(int k, int &a, int &b)
+	{
+		int nr_vert = (_w-1)*_h;
+		if (k < nr_vert)
+		{
+			a = k / _h + 1 + (_w+1)*(k % _h);
+			b = a + (_w+1);
+		}
+		else
+		{
+			k -= nr_vert;
+			a = k % _w + (_w+1)*(k / _w + 1);
+			b = a + 1;
+		}
+	}
+	int _cornerEdges(int c, int *edges)
+	{
+		int nr_vert = (_w-1)*_h;
+		int x = c % (_w+1);
+		int y = c / (_w+1);
+		int n = 0;
+		if (0 < x && x < _w)
+		{
+			if (y > 0)  edges[n++] = _h*(x-1) + y-1;
+			if (y < _h) edges[n++] = _h*(x-1) + y;
+		}
+		if (0 < y && y < _h)
+		{
+			if (x > 0)  edges[n++] = nr_vert + x-1 + _w*(y-1);
+			if (x < _w) edges[n++] = nr_vert + x + _w*(y-1);
+		}
+		return n;
+	}
+	// Fisher-Yates shuffle, which draws the random indices for a block
+	// of positions before swapping, such that drawing them does not wait
+	// for the loads and stores of the swaps. The indices are drawn in the
+	// same order as when drawing them one at a time.
+	void _shuffle(int *a, int n)
+	{
+		const int block = 64;
+		int j[block];
+		for (int k = n - 1; k > 0; k -= block)
+		{
+			int m = k < block ? k : block;
+			for (int q = 0; q < m; q++)
+				j[q] = _rand(k - q + 1);
+			for (int q = 0; q < m; q++)
+			{
+				int t = a[k - q];
+				a[k - q] = a[j[q]];
+				a[j[q]] = t;
+			}
+		}
+	}
+	void _calcStats(int* types, int* one, int* two_straight, int* two_turn, int* three, int* four)
+	{
+		for (int i = 0; i < 16; i++)
+			types[i] = 0;
+		if ((long)_w*_h < stats_grain || std::thread::hardware_concurrency() <= 1)
+			_countTypes(0, _h, types);
+		else
+		{
+			// Very large mazes are counted in blocks of rows on a pool of
+			// threads, each block with its own histogram
+			int rows = (stats_grain + _w - 1) / _w;
+			int nr_blocks = (_h + rows - 1) / rows;
+			int (*block_types)[16] = new int[nr_blocks][16]();
+			TaskPool pool(0);
+			for (int b = 0; b < nr_blocks; b++)
+				pool.spawn(0, [this, b, rows, block_types](int) { _countTypes(b*rows, (b+1)*rows < _h ? (b+1)*rows : _h, block_types[b]); });
+			pool.run();
+			for (int b = 0; b < nr_blocks; b++)
+				for (int i = 0; i < 16; i++)
+					types[i] += block_types[b][i];
+			delete[] block_types;
+		}
+		*one = types[1] + types[2] + types[4] + types[8];
+		*two_straight = types[1+4] + types[2 + 8];
+		*two_turn = types[1 + 2] + types[2 + 4] + types[4 + 8] + types[8 + 1];
+		*three = types[1 + 2 + 4] + types[2 + 4 + 8] + types [4 + 8 + 1] + types[8 + 1 + 2];
+		*four = types[1 + 2 + 4 + 8];
+	}
+	static const int stats_grain = 1 << 20;
+	// Adds the histogram of the types of the rooms in the rows j_from up
+	// to j_to
+	void _countTypes(int j_from, int j_to, int *types)
+	{
+		if (std::is_same<Layout, RowLayout>::value)
+		{
+			_countRowTypes(j_from, j_to, types);
+			return;
+		}
+		for (int j = j_from; j < j_to; j++)
+			for (int i = 0; i < _w; i++)
+				types[  (_hasWall(i, j, 0) ? 0 : 1)
+				      | (_hasWall(i, j, 1) ? 0 : 2)
+				      | (_hasWall(i, j, 2) ? 0 : 4)
+				      | (_hasWall(i, j, 3) ? 0 : 8)]++;
+	}
+	void _countRowTypes(int j_from, int j_to, int *types)
+	{
+		// As _countTypes for the row layout, 32 rooms at a time: the edges
+		// of 32 consecutive rooms in each direction are in a single mask
+		// from a plane, with bit 2k for room k. The rooms of each type
+		// are selected by combining the masks, and counted with popcount.
+		const uint64_t even = 0x5555555555555555ull;
+		for (int j = j_from; j < j_to; j++)
+			for (int i = 0; i < _w; i += 32)
+			{
+				int c = _cell(i, j);
+				uint64_t valid = _w - i >= 32 ? even : even & ((1ull << (2*(_w - i))) - 1);
+				uint64_t r = _planes[0].passages(c);
+				uint64_t b = _planes[1].passages(c);
+				uint64_t l = _planes[0].passages(_layout.edgeCell(c, 2));
+				uint64_t t = _planes[1].passages(_layout.edgeCell(c, 3));
+				uint64_t rb[4] = { ~r & ~b, r & ~b, ~r & b, r & b };
+				uint64_t lt[4] = { ~l & ~t, l & ~t, ~l & t, l & t };
+				for (int k = 0; k < 16; k++)
+					types[k] += __builtin_popcountll(rb[k & 3] & lt[k >> 2] & valid);
+			}
+	}
+	int _bfs(int root, int *order, int *parent, bool *removed)
+	{
+		// Breadth-first traversal of the rooms reachable from root through
+		// passages, skipping removed rooms. Fills order with the rooms in
+		// the order they were reached and parent with the room each was
+		// reached from. Returns the number of rooms reached.
+		int n = 0;
+		order[n++] = root;
+		parent[root] = -1;
+		for (int k = 0; k < n; k++)
+		{
+			int r = order[k];
+			int i = r % _w;
+			int j = r / _w;
+			for (int d = 0; d < 4; d++)
+				if (!_hasWall(i, j, d))
+				{
+					int s = _neighbour(r, d);
+					if (s != parent[r] && !removed[s])
+					{
+						parent[s] = r;
+						order[n++] = s;
+					}
+				}
+		}
+		return n;
+	}
+	static void _selfConvolve(long *a, int n, long *result, Workspace &ws)
+	{
+		// Sets result[0..2n-2] to the convolution of a[0..n-1] with itself,
+		// with an FFT for larger arrays. The rounding error of the FFT
+		// grows with the square of the sum of a (the largest result) times
+		// the log of the size, so it is only used as long as that stays
+		// far below 2^53, where the rounded results are exact. For larger
+		// sums, a number theoretic transform is used: an FFT modulo a
+		// prime, which is exact. It is done modulo two primes, and the
+		// results are combined with the Chinese remainder theorem, which
+		// is exact for results below their product (about 2^56), as the
+		// results are at most the square of the number of rooms.
+		int size = 1;
+		while (size < 2*n-1)
+			size *= 2;
+		if (n <= 64 || size > ntt_max_size)
+		{
+			for (int l = 0; l < 2*n-1; l++)
+				result[l] = 0;
+			for (int x = 0; x < n; x++)
+				if (a[x] != 0)
+					for (int y = 0; y < n; y++)
+						result[x+y] += a[x] * a[y];
+			return;
+		}
+		double sum = 0;
+		for (int x = 0; x < n; x++)
+			sum += a[x];
+		long mark = ws.mark();
+		if (sum*sum*log2(size) < (double)(1L << 47))
+		{
+			std::complex<double> *f = ws.alloc<std::complex<double> >(size);
+			for (int x = 0; x < size; x++)
+				f[x] = x < n ? a[x] : 0;
+			_fft(f, size, false);
+			for (int x = 0; x < size; x++)
+				f[x] *= f[x];
+			_fft(f, size, true);
+			for (int l = 0; l < 2*n-1; l++)
+				result[l] = (long)floor(f[l].real() / size + 0.5);
+			ws.release(mark);
+			return;
+		}
+		uint32_t *f[2];
+		for (int q = 0; q < 2; q++)
+		{
+			uint32_t p = ntt_primes[q];
+			f[q] = ws.alloc<uint32_t>(size);
+			for (int x = 0; x < size; x++)
+				f[q][x] = x < n ? (uint32_t)(a[x] % p) : 0;
+			_ntt(f[q], size, p, false);
+			for (int x = 0; x < size; x++)
+				f[q][x] = (uint32_t)((uint64_t)f[q][x] * f[q][x] % p);
+			_ntt(f[q], size, p, true);
+		}
+		const uint64_t p0 = ntt_primes[0];
+		const uint64_t p1 = ntt_primes[1];
+		const uint64_t inv_p0 = _powMod(p0 % p1, p1 - 2, p1);
+		for (int l = 0; l < 2*n-1; l++)
+		{
+			uint64_t k = (f[1][l] + p1 - f[0][l] % p1) % p1 * inv_p0 % p1;
+			result[l] = (long)(f[0][l] + p0 * k);
+		}
+		ws.release(mark);
+	}
+	// Primes of the form c*2^k+1 with 3 as primitive root, such that the
+	// transform of sizes up to 2^25 exists modulo both
+	static const uint32_t ntt_primes[2];
+	static const int ntt_max_size = 1 << 25;
+	static uint64_t _powMod(uint64_t b, uint64_t e, uint64_t p)
+	{
+		uint64_t r = 1;
+		for (b %= p; e > 0; e >>= 1, b = b * b % p)
+			if (e & 1)
+				r = r * b % p;
+		return r;
+	}
+	static void _fft(std::complex<double> *a, int n, bool invert)
+	{
+		for (int i = 1, j = 0; i < n; i++)
+		{
+			int bit = n >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j)
+			{
+				std::complex<double> t = a[i];
+				a[i] = a[j];
+				a[j] = t;
+			}
+		}
+		for (int len = 2; len <= n; len *= 2)
+		{
+			double angle = 2 * M_PI / len * (invert ? -1 : 1);
+			std::complex<double> wlen(cos(angle), sin(angle));
+			for (int i = 0; i < n; i += len)
+			{
+				std::complex<double> w(1);
+				for (int k = 0; k < len/2; k++)
+				{
+					std::complex<double> u = a[i+k];
+					std::complex<double> v = a[i+k+len/2] * w;
+					a[i+k] = u + v;
+					a[i+k+len/2] = u - v;
+					w *= wlen;
+				}
+			}
+		}
+	}
+	static void _ntt(uint32_t *a, int n, uint64_t p, bool invert)
+	{
+		for (int i = 1, j = 0; i < n; i++)
+		{
+			int bit = n >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j)
+			{
+				uint32_t t = a[i];
+				a[i] = a[j];
+				a[j] = t;
+			}
+		}
+		for (int len = 2; len <= n; len *= 2)
+		{
+			uint64_t wlen = _powMod(3, (p - 1) / len, p);
+			if (invert)
+				wlen = _powMod(wlen, p - 2, p);
+			for (int i = 0; i < n; i += len)
+			{
+				uint64_t w = 1;
+				for (int k = 0; k < len/2; k++)
+				{
+					uint64_t u = a[i+k];
+					uint64_t v = a[i+k+len/2] * w % p;
+					a[i+k] = (uint32_t)(u + v < p ? u + v : u + v - p);
+					a[i+k+len/2] = (uint32_t)(u >= v ? u - v : u + p - v);
+					w = w * wlen % p;
+				}
+			}
+		}
+		if (invert)
+		{
+			uint64_t inv_n = _powMod(n, p - 2, p);
+			for (int i = 0; i < n; i++)
+				a[i] = (uint32_t)(a[i] * inv_n % p);
+		}
+	}
+	int _w, _h;
+	uint64_t _seed;
+	int _algorithm;
+	Layout _layout;
+	Plane _planes[2];
+	Rng _rng;
+	Workspace _workspace;
+	Workspace *_ws;
+	Workspace &_scratch() { return _ws != 0 ? *_ws : _workspace; }
+#ifdef MAZE_STATS
+	MazeCounters _counters;
+#endif
+};
+
+template <class Plane, class Rng, class Layout>
+const uint32_t MazeT<Plane, Rng, Layout>::ntt_primes[2] = { 469762049, 167772161 };
+
+typedef MazeT<> Maze;
+
+// Generates a batch of mazes of the same size at once, for sampling the
+// statistics of many small mazes. The traversals are stored bit sliced:
+// per cell a word with a bit for each maze that has a passage there.
+// The mazes are generated with Wilson's algorithm, such that they have
+// the same distribution as those of MazeT::generateWilson, by a number
+// of walkers that take the steps of their walks in lockstep, each with
+// its own xoshiro128** random number generator, such that the loops over
+// the walkers have no dependencies between the iterations. A walker that
+// is done with its maze continues with the next maze of the batch, as
+// the lengths of the walks vary a lot. The rooms that are not included
+// are taken as starting points in order, which does not change the
+// distribution. Hard walls are not supported.
+class MazeBatch
+{
+public:
+	typedef uint64_t mazes_t;
+	static const int nr_mazes = 64;
+	static const int nr_walkers = 16;
+	MazeBatch(int w, int h, uint64_t seed = 0) : _w(w), _h(h), _pw(w + 2)
+	{
+		int nr_cells = _pw*(_h + 2);
+		_passages[0] = new mazes_t[nr_cells];
+		_passages[1] = new mazes_t[nr_cells];
+		_included = new mazes_t[nr_cells];
+		_next = new int[4*nr_cells];
+		_dir = new unsigned char[nr_cells*nr_mazes];
+		_rooms = new int[_w*_h];
+		_order = new int[_w*_h];
+		_back = new unsigned char[nr_cells];
+		_size = new long[nr_cells];
+		_step[0] = 1;   _offset[0] = 0;
+		_step[1] = _pw; _offset[1] = 0;
+		_step[2] = -1;  _offset[2] = -1;
+		_step[3] = -_pw; _offset[3] = -_pw;
+		for (int c = 0; c < nr_cells; c++)
+			for (int d = 0; d < 4; d++)
+				_next[4*c + d] = c;
+		for (int j = 0; j < _h; j++)
+			for (int i = 0; i < _w; i++)
+			{
+				int c = _cell(i, j);
+				_rooms[i + _w*j] = c;
+				bool inside[4] = { i < _w-1, j < _h-1, i > 0, j > 0 };
+				for (int d = 0; d < 4; d++)
+					if (inside[d])
+						_next[4*c + d] = c + _step[d];
+			}
+		this->seed(seed);
+	}
+	~MazeBatch()
+	{
+		delete[] _passages[0];
+		delete[] _passages[1];
+		delete[] _included;
+		delete[] _next;
+		delete[] _dir;
+		delete[] _rooms;
+		delete[] _order;
+		delete[] _back;
+		delete[] _size;
+	}
+	void seed(uint64_t seed)
+	{
+		Xoshiro256 rng(seed);
+		for (int l = 0; l < nr_walkers; l++)
+		{
+			uint64_t a = rng.next();
+			uint64_t b = rng.next();
+			_s0[l] = (uint32_t)a;
+			_s1[l] = (uint32_t)(a >> 32);
+			_s2[l] = (uint32_t)b;
+			_s3[l] = (uint32_t)(b >> 32) | 1;
+		}
+	}
+	bool right(int m, int i, int j) { return (_passages[0][_cell(i, j)] >> m) & 1; }
+	bool bottom(int m, int i, int j) { return (_passages[1][_cell(i, j)] >> m) & 1; }
+	void generate()
+	{
+		int nr_cells = _pw*(_h + 2);
+		for (int c = 0; c < nr_cells; c++)
+			_passages[0][c] = _passages[1][c] = _included[c] = 0;
+		uint32_t bits[nr_walkers];
+		for (int m = 0; m < nr_mazes; m++)
+		{
+			if (m % nr_walkers == 0)
+				_random(bits);
+			_included[_rooms[(int)(((uint64_t)bits[m % nr_walkers] * (uint32_t)(_w*_h)) >> 32)]] |= (mazes_t)1 << m;
+			_next_room[m] = 0;
+		}
+		// Each round, all walkers take a step of their walk. Only when a
+		// walk reaches an included room, the walker traces it back from
+		// its start, including the rooms on the way, and starts the next
+		// walk. Walkers that are done walk in the first cell of the
+		// border, from which no steps are possible.
+		int cur[nr_walkers], start[nr_walkers], maze[nr_walkers];
+		int next_maze = 0;
+		int active = nr_walkers;
+		for (int l = 0; l < nr_walkers; l++)
+		{
+			maze[l] = next_maze++;
+			_nextStart(maze[l], cur[l], start[l]);
+		}
+		for (int round = 0; active > 0; round++)
+		{
+			if (round % 16 == 0)
+				_random(bits);
+			for (int l = 0; l < nr_walkers; l++)
+			{
+				int c = cur[l];
+				int d = bits[l] & 3;
+				bits[l] >>= 2;
+				// A step that would leave the maze, leaves the direction to
+				// be overwritten by the next step
+				_dir[c*nr_mazes + maze[l]] = (unsigned char)d;
+				c = _next[4*c + d];
+				cur[l] = c;
+				if ((_included[c] >> maze[l]) & 1)
+				{
+					_trace(maze[l], start[l]);
+					while (!_nextStart(maze[l], cur[l], start[l]))
+						if (next_maze < nr_mazes)
+							maze[l] = next_maze++;
+						else
+						{
+							maze[l] = 0;
+							cur[l] = 0;
+							active--;
+							break;
+						}
+				}
+			}
+		}
+	}
+	// Sets the passages of maze to those of maze m of the batch
+	template <class M>
+	void copyTo(int m, M &maze)
+	{
+		for (int i = 0; i < _w; i++)
+			for (int j = 0; j < _h; j++)
+			{
+				if (i < _w-1)
+					maze.right(i, j) = right(m, i, j) ? s_passage : s_wall;
+				if (j < _h-1)
+					maze.bottom(i, j) = bottom(m, i, j) ? s_passage : s_wall;
+			}
+	}
+	// Adds the statistics of each maze, as MazeT::calcStats does. The
+	// histogram of the types of the rooms, by their passages, is kept
+	// in bit sliced counters: bit m of _count[t][p] is bit p of the count
+	// of type t of maze m, such that each room is counted for all mazes
+	// with a few operations per type.
+	void calcStats(Stat (&stats)[22])
+	{
+		int nr_bits = 1;
+		while ((1 << nr_bits) <= _w*_h)
+			nr_bits++;
+		for (int t = 0; t < 16; t++)
+			for (int p = 0; p < nr_bits; p++)
+				_count[t][p] = 0;
+		for (int j = 0; j < _h; j++)
+			for (int i = 0; i < _w; i++)
+			{
+				int c = _cell(i, j);
+				mazes_t r = _passages[0][c];
+				mazes_t b = _passages[1][c];
+				mazes_t l = _passages[0][c - 1];
+				mazes_t u = _passages[1][c - _pw];
+				mazes_t rb[4] = { ~r & ~b, r & ~b, ~r & b, r & b };
+				mazes_t lu[4] = { ~l & ~u, l & ~u, ~l & u, l & u };
+				for (int t = 0; t < 16; t++)
+				{
+					mazes_t m = rb[t & 3] & lu[t >> 2];
+					for (int p = 0; m != 0; p++)
+					{
+						mazes_t carry = _count[t][p] & m;
+						_count[t][p] ^= m;
+						m = carry;
+					}
+				}
+			}
+		double tot = _w * _h;
+		for (int m = 0; m < nr_mazes; m++)
+		{
+			int types[16];
+			for (int t = 0; t < 16; t++)
+			{
+				types[t] = 0;
+				for (int p = 0; p < nr_bits; p++)
+					types[t] |= (int)((_count[t][p] >> m) & 1) << p;
+				stats[t].add(types[t]/tot);
+			}
+			stats[16].add((types[1] + types[2] + types[4] + types[8])/tot);
+			stats[17].add((types[1+4] + types[2+8])/tot);
+			stats[18].add((types[1+2] + types[2+4] + types[4+8] + types[8+1])/tot);
+			stats[19].add((types[1+2+4] + types[2+4+8] + types[4+8+1] + types[8+1+2])/tot);
+			stats[20].add(types[1+2+4+8]/tot);
+			stats[21].add(_averageDist(m));
+		}
+	}
+private:
+	int _cell(int i, int j) { return (i+1) + _pw*(j+1); }
+	void _random(uint32_t *bits)
+	{
+		// xoshiro128** (https://prng.di.unimi.it/) for all walkers at once
+		for (int l = 0; l < nr_walkers; l++)
+		{
+			uint32_t m = _s1[l] * 5;
+			bits[l] = ((m << 7) | (m >> 25)) * 9;
+			uint32_t t = _s1[l] << 9;
+			_s2[l] ^= _s0[l];
+			_s3[l] ^= _s1[l];
+			_s1[l] ^= _s2[l];
+			_s0[l] ^= _s3[l];
+			_s2[l] ^= t;
+			_s3[l] = (_s3[l] << 11) | (_s3[l] >> 21);
+		}
+	}
+	// Includes the rooms on the walk in maze m from start
+	void _trace(int m, int c)
+	{
+		mazes_t bit = (mazes_t)1 << m;
+		while (!(_included[c] & bit))
+		{
+			_included[c] |= bit;
+			int d = _dir[c*nr_mazes + m];
+			_passages[d & 1][c + _offset[d]] |= bit;
+			c += _step[d];
+		}
+	}
+	// Starts a walk in maze m from the next room that is not included.
+	// Returns false when all rooms are included.
+	bool _nextStart(int m, int &cur, int &start)
+	{
+		mazes_t bit = (mazes_t)1 << m;
+		while (_next_room[m] < _w*_h && (_included[_rooms[_next_room[m]]] & bit))
+			_next_room[m]++;
+		if (_next_room[m] == _w*_h)
+			return false;
+		cur = start = _rooms[_next_room[m]];
+		return true;
+	}
+	double _averageDist(int m)
+	{
+		// As MazeT::averageDist: the sum over all passages of the product
+		// of the sizes of the parts on both sides. The rooms are traversed
+		// by their cells, and _back holds the direction to the parent.
+		int n = _w*_h;
+		int k_end = 1;
+		_order[0] = _rooms[0];
+		_back[_rooms[0]] = 4;
+		for (int k = 0; k < k_end; k++)
+		{
+			int c = _order[k];
+			_size[c] = 1;
+			int open = (int)(((_passages[0][c] >> m) & 1)
+			               | ((_passages[1][c] >> m) & 1) << 1
+			               | ((_passages[0][c - 1] >> m) & 1) << 2
+			               | ((_passages[1][c - _pw] >> m) & 1) << 3) & ~(1 << _back[c]);
+			for (; open != 0; open &= open - 1)
+			{
+				int d = __builtin_ctz(open);
+				int next = c + _step[d];
+				_back[next] = (unsigned char)((d + 2) & 3);
+				_order[k_end++] = next;
+			}
+		}
+		long sum = 0;
+		for (int k = n-1; k > 0; k--)
+		{
+			int c = _order[k];
+			sum += _size[c] * (n - _size[c]);
+			_size[c + _step[_back[c]]] += _size[c];
+		}
+		return sum / (n*(n-1.0)/2);
+	}
+	int _w, _h, _pw;
+	int _step[4];
+	int _offset[4];
+	mazes_t *_passages[2];
+	mazes_t *_included;
+	// The cell reached by a step from each cell in each direction, which
+	// is the cell itself for steps that would leave the maze
+	int *_next;
+	// The direction of the last step of the walk from each room
+	unsigned char *_dir;
+	int _next_room[nr_mazes];
+	// The cell of each room, and the scratch arrays of _averageDist
+	int *_rooms;
+	int *_order;
+	unsigned char *_back;
+	long *_size;
+	uint32_t _s0[nr_walkers], _s1[nr_walkers], _s2[nr_walkers], _s3[nr_walkers];
+	mazes_t _count[16][32];
+};
+
+// A maze file, as written by Maze::save, mapped into memory. The maze
+// uses the mapped planes without copying them. The mapping is private,
+// so changes made to the maze, such as stamping, are not written back.
+class MazeFile
+{
+public:
+	MazeFile() : _data(0), _size(0), _maze(0) {}
+	~MazeFile() { close(); }
+	bool open(const char *filename)
+	{
+		close();
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0)
+		{
+			fprintf(stderr, "Cannot open file '%s' for reading\n", filename);
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(MazeFileHeader))
+		{
+			_size = st.st_size;
+			_data = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (_data == MAP_FAILED)
+				_data = 0;
+		}
+		::close(fd);
+		MazeFileHeader *header = (MazeFileHeader*)_data;
+		if (header == 0 || !_valid(header))
+		{
+			fprintf(stderr, "File '%s' is not a valid maze file\n", filename);
+			close();
+			return false;
+		}
+		_maze = new Maze(header);
+		return true;
+	}
+	void close()
+	{
+		delete _maze;
+		_maze = 0;
+		if (_data != 0)
+			munmap(_data, _size);
+		_data = 0;
+	}
+	Maze &maze() { return *_maze; }
+	const MazeFileHeader &header() { return *(MazeFileHeader*)_data; }
+private:
+	bool _valid(MazeFileHeader *header)
+	{
+		if (   memcmp(header->magic, "MAZE", 4) != 0 || header->byte_order != 0x01020304
+		    || header->version != 1 || header->w < 1 || header->h < 1)
+			return false;
+		long nr_words = 2*(((header->w+2L)*(header->h+2) + 15)/16);
+		return _size >= (long)sizeof(MazeFileHeader) + nr_words*(long)sizeof(unsigned);
+	}
+	void *_data;
+	long _size;
+	Maze *_maze;
+};
+
+// Receives the rows of a maze that is generated one row at a time. For
+// row j, right[i] tells whether there is a wall between rooms (i,j) and
+// (i+1,j), and bottom[i] whether there is a wall between (i,j) and
+// (i,j+1). In the last row, all bottom walls are set.
+class RowConsumer
+{
+public:
+	virtual ~RowConsumer() {}
+	virtual void begin(int /*w*/, long /*h*/) {}
+	virtual void row(long j, const bool *right, const bool *bottom) = 0;
+	virtual void end() {}
+};
+
+// Eller's algorithm (http://www.neocomputer.org/projects/eller.html),
+// which generates a maze row by row using memory proportional to the
+// width only. The rooms in the current row are labeled with the set of
+// rooms they are connected to through the rows above.
+class EllerGenerator
+{
+public:
+	EllerGenerator(int w, long h, uint64_t seed) : _w(w), _h(h), _rng(seed), _bits(0), _nr_bits(0) {}
+	void generate(RowConsumer &consumer)
+	{
+		int *label = new int[_w];
+		int *parent = new int[_w];
+		int *count = new int[_w];
+		int *chosen = new int[_w];
+		bool *right = new bool[_w];
+		bool *bottom = new bool[_w];
+		bool *used = new bool[_w];
+		for (int i = 0; i < _w; i++)
+			label[i] = i;
+		consumer.begin(_w, _h);
+		for (long j = 0; j < _h; j++)
+		{
+			bool last = j == _h - 1;
+			// Join neighbouring rooms of different sets at random, and
+			// all of them in the last row
+			for (int i = 0; i < _w; i++)
+				parent[i] = i;
+			for (int i = 0; i < _w-1; i++)
+			{
+				int a = _find(parent, label[i]);
+				int b = _find(parent, label[i+1]);
+				right[i] = a == b || (!last && _coin());
+				if (!right[i])
+					parent[b] = a;
+			}
+			right[_w-1] = true;
+			for (int i = 0; i < _w; i++)
+				label[i] = _find(parent, label[i]);
+			if (last)
+			{
+				for (int i = 0; i < _w; i++)
+					bottom[i] = true;
+				consumer.row(j, right, bottom);
+				break;
+			}
+			// Open passages down at random, and make sure that every set
+			// has at least one, by picking one of the rooms of each set
+			// that has none at random.
+			for (int i = 0; i < _w; i++)
+				count[i] = 0;
+			for (int i = 0; i < _w; i++)
+			{
+				bottom[i] = _coin();
+				if (!bottom[i])
+					count[label[i]] = -1;
+				else if (count[label[i]] >= 0 && _rng.below(++count[label[i]]) == 0)
+					chosen[label[i]] = i;
+			}
+			for (int i = 0; i < _w; i++)
+				if (count[label[i]] > 0 && chosen[label[i]] == i)
+					bottom[i] = false;
+			consumer.row(j, right, bottom);
+			// Label the next row: rooms below a passage keep the label of
+			// their set, the other rooms get an unused label
+			for (int i = 0; i < _w; i++)
+				used[i] = false;
+			for (int i = 0; i < _w; i++)
+				if (!bottom[i])
+					used[label[i]] = true;
+			int next_free = 0;
+			for (int i = 0; i < _w; i++)
+				if (bottom[i])
+				{
+					while (used[next_free])
+						next_free++;
+					used[next_free] = true;
+					label[i] = next_free;
+				}
+		}
+		consumer.end();
+		delete[] label;
+		delete[] parent;
+		delete[] count;
+		delete[] chosen;
+		delete[] right;
+		delete[] bottom;
+		delete[] used;
+	}
+private:
+	bool _coin()
+	{
+		if (_nr_bits == 0)
+		{
+			_bits = _rng.next();
+			_nr_bits = 64;
+		}
+		_nr_bits--;
+		bool result = _bits & 1;
+		_bits >>= 1;
+		return result;
+	}
+	static int _find(int *parent, int a)
+	{
+		while (parent[a] != a)
+		{
+			parent[a] = parent[parent[a]];
+			a = parent[a];
+		}
+		return a;
+	}
+	int _w;
+	long _h;
+	Xoshiro256 _rng;
+	uint64_t _bits;
+	int _nr_bits;
+};
+
+// Prints the rows in the same format as Maze::print()
+class TextRows : public RowConsumer
+{
+public:
+	TextRows(FILE *f) : _f(f), _w(0), _above(0) {}
+	~TextRows() { delete[] _above; }
+	void begin(int w, long /*h*/)
+	{
+		_w = w;
+		_above = new bool[w];
+		for (int i = 0; i < w; i++)
+			_above[i] = true;
+		_first = true;
+	}
+	void row(long /*j*/, const bool *right, const bool *bottom)
+	{
+		for (int i = 0; i < _w; i++)
+			fprintf(_f, "+%c", _above[i] ? (_first ? '=' : '-') : ' ');
+		fprintf(_f, "+\n");
+		for (int i = 0; i < _w; i++)
+			fprintf(_f, "%c ", i == 0 ? '|' : right[i-1] ? ':' : ' ');
+		fprintf(_f, "|\n");
+		for (int i = 0; i < _w; i++)
+			_above[i] = bottom[i];
+		_first = false;
+	}
+	void end()
+	{
+		for (int i = 0; i < _w; i++)
+			fprintf(_f, "+-");
+		fprintf(_f, "+\n");
+	}
+private:
+	FILE *_f;
+	int _w;
+	bool *_above;
+	bool _first;
+};
+
+// Writes the rows as SVG, with a line segment for every run of walls.
+// Sizes are as for Maze::svg(), with the border always included.
+class SvgRows : public RowConsumer
+{
+public:
+	SvgRows(FILE *f, double wall_width, double hall_width, const char *color, double stroke_width)
+	: _f(f), _wall_width(wall_width), _hall_width(hall_width), _color(color), _stroke_width(stroke_width), _w(0), _h(0) {}
+	void begin(int w, long h)
+	{
+		_w = w;
+		_h = h;
+		double step = _wall_width + _hall_width;
+		fprintf(_f, "<svg width=\"%.0f\" height=\"%.0f\" xmlns=\"http://www.w3.org/2000/svg\">\n",
+				step*(w+1), step*(h+1));
+		fprintf(_f, "<path d=\"M%.2lf %.2lf h %.2lf v %.2lf h %.2lf Z\n",
+				step/2, step/2, step*w, step*h, -step*w);
+	}
+	void row(long j, const bool *right, const bool *bottom)
+	{
+		double step = _wall_width + _hall_width;
+		for (int i = 0; i < _w-1; i++)
+			if (right[i])
+				fprintf(_f, "M%.2lf %.2lf v %.2lf\n", step*(i+1.5), step*(j+0.5), step);
+		for (int i = 0; i < _w; i++)
+			if (bottom[i] && j < _h-1)
+			{
+				int k = i;
+				while (k + 1 < _w && bottom[k + 1])
+					k++;
+				fprintf(_f, "M%.2lf %.2lf h %.2lf\n", step*(i+0.5), step*(j+1.5), step*(k+1-i));
+				i = k;
+			}
+	}
+	void end()
+	{
+		fprintf(_f, "\" stroke=\"%s\" stroke-width=\"%.2lf\" fill-opacity=\"0.0\"/></svg>\n", _color, _stroke_width);
+	}
+private:
+	FILE *_f;
+	double _wall_width, _hall_width;
+	const char *_color;
+	double _stroke_width;
+	int _w;
+	long _h;
+};
+
+// Writes the rows in a binary format: the characters "MZRW", the width as
+// a 32-bit and the height as a 64-bit integer, followed by the rows. Each
+// row holds the w-1 right walls followed by the w bottom walls, one bit
+// each starting with the lowest bit, padded to a whole byte.
+class BinaryRows : public RowConsumer
+{
+public:
+	BinaryRows(FILE *f) : _f(f), _w(0), _bytes(0) {}
+	~BinaryRows() { delete[] _bytes; }
+	void begin(int w, long h)
+	{
+		_w = w;
+		_bytes = new unsigned char[_nrBytes()];
+		int32_t w32 = w;
+		int64_t h64 = h;
+		fwrite("MZRW", 1, 4, _f);
+		fwrite(&w32, sizeof(w32), 1, _f);
+		fwrite(&h64, sizeof(h64), 1, _f);
+	}
+	void row(long /*j*/, const bool *right, const bool *bottom)
+	{
+		for (int k = 0; k < _nrBytes(); k++)
+			_bytes[k] = 0;
+		for (int i = 0; i < 2*_w-1; i++)
+			if (i < _w-1 ? right[i] : bottom[i - (_w-1)])
+				_bytes[i/8] |= 1 << (i%8);
+		fwrite(_bytes, 1, _nrBytes(), _f);
+	}
+private:
+	int _nrBytes() { return (2*_w-1 + 7)/8; }
+	FILE *_f;
+	int _w;
+	unsigned char *_bytes;
+};
+
+// Copies the rows into a Maze of the same size
+class MazeRows : public RowConsumer
+{
+public:
+	MazeRows(Maze &maze) : _maze(maze), _w(0), _h(0) {}
+	void begin(int w, long h)
+	{
+		_w = w;
+		_h = h;
+	}
+	void row(long j, const bool *right, const bool *bottom)
+	{
+		for (int i = 0; i < _w-1; i++)
+			if (!right[i])
+				_maze.right(i, j) = s_passage;
+		if (j < _h-1)
+			for (int i = 0; i < _w; i++)
+				if (!bottom[i])
+					_maze.bottom(i, j) = s_passage;
+	}
+private:
+	Maze &_maze;
+	int _w;
+	long _h;
+};
+
+void dist_kind(Stat* stats, int* vec, int n, const char *name)
+{
+	for (int i = 0; i < n; i++)
+		printf(" %5.2lf(%5.2lf)", 100*stats[vec[i]].avg(), 100*stats[vec[i]].stddev());
+	double max_dist = 0;
+	double sum_dist = 0;
+	for (int i = 0; i < n-1; i++)
+		for (int j = i+1; j < n; j++)
+		{
+			double dist = Stat::dist(stats[vec[i]], stats[vec[j]]);
+			if (dist > max_dist)
+				max_dist = dist;
+			sum_dist += dist;
+		}
+	printf(" %s = %6.3lf %6.3lf", name, max_dist, sum_dist);
+	printf(" %6.3lf |", sum_dist);
+}
+
+// Searches the seeds from..to for those giving the mazes with the most
+// uniform distribution of the types of rooms, that is, the lowest
+// calcDist. The maze of a seed is a 30x30 maze generated with Wilson's
+// algorithm around a 6x6 maze generated with generateRecursive, which
+// is stamped stretched into it. The seeds are handed out in blocks to
+// a number of threads, and the best k seeds are kept. The calculation
+// of calcDist is stopped as soon as the result is known to be worse
+// than the k-th best found so far. The progress can be saved in a file
+// and a search can be resumed from it.
+class SeedSearch
+{
+public:
+	struct Result
+	{
+		long seed;
+		long dist;
+	};
+	SeedSearch(int k, long from, long to)
+	: _k(k), _nr_best(0), _best(new Result[k]), _to(to), _next(from), _limit(LONG_MAX), _in_work(0), _nr_threads(0) {}
+	~SeedSearch()
+	{
+		delete[] _best;
+		delete[] _in_work;
+	}
+	static void generate(long seed, Maze &pattern, Maze &maze)
+	{
+		pattern.reset(seed);
+		pattern.generateRecursive();
+		maze.reset(seed);
+		maze.stampStreched(pattern);
+		maze.generateWilson();
+	}
+	// Searches the remaining seeds, saving the progress in checkpoint
+	// (when not null) every interval seconds and at the end
+	void run(int nr_threads, const char *checkpoint = 0, double interval = 60)
+	{
+		if (nr_threads <= 0)
+			nr_threads = std::thread::hardware_concurrency();
+		if (nr_threads <= 0)
+			nr_threads = 1;
+		_nr_threads = nr_threads;
+		delete[] _in_work;
+		_in_work = new long[nr_threads];
+		for (int t = 0; t < nr_threads; t++)
+			_in_work[t] = LONG_MAX;
+		_last_save = std::chrono::steady_clock::now();
+		std::thread *workers = new std::thread[nr_threads-1];
+		for (int t = 0; t < nr_threads-1; t++)
+			workers[t] = std::thread(&SeedSearch::_work, this, t+1, checkpoint, interval);
+		_work(0, checkpoint, interval);
+		for (int t = 0; t < nr_threads-1; t++)
+			workers[t].join();
+		delete[] workers;
+		if (checkpoint != 0)
+			save(checkpoint);
+	}
+	// The file holds the first seed that is not yet searched, followed
+	// by the best seeds found before it with their calcDist
+	bool save(const char *filename)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		char tmp_name[1000];
+		snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", filename);
+		FILE *f = fopen(tmp_name, "wt");
+		if (f == 0)
+		{
+			fprintf(stderr, "Cannot open file '%s' for writing\n", tmp_name);
+			return false;
+		}
+		fprintf(f, "%ld %d\n", _done(), _nr_best);
+		for (int i = 0; i < _nr_best; i++)
+			fprintf(f, "%ld %ld\n", _best[i].seed, _best[i].dist);
+		fclose(f);
+		// Replacing the file, such that it is never incomplete
+		return rename(tmp_name, filename) == 0;
+	}
+	bool load(const char *filename)
+	{
+		FILE *f = fopen(filename, "rt");
+		if (f == 0)
+			return false;
+		long done;
+		int nr;
+		bool ok = fscanf(f, "%ld %d", &done, &nr) == 2;
+		for (int i = 0; i < nr && ok; i++)
+		{
+			Result r;
+			ok = fscanf(f, "%ld %ld", &r.seed, &r.dist) == 2;
+			if (ok)
+				_add(r.seed, r.dist);
+		}
+		fclose(f);
+		if (ok && done > _next)
+			_next = done;
+		return ok;
+	}
+	int nrBest() { return _nr_best; }
+	Result &best(int i) { return _best[i]; }
+	long next() { return _next; }
+private:
+	static const int block_size = 64;
+	void _work(int t, const char *checkpoint, double interval)
+	{
+		Maze pattern(6, 6);
+		Maze maze(30, 30);
+		pattern.useWorkspace(&maze.workspace());
+		for (;;)
+		{
+			long from;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				from = _next;
+				if (from >= _to)
+					break;
+				_next = from + block_size < _to ? from + block_size : _to;
+				_in_work[t] = from;
+			}
+			for (long seed = from; seed < from + block_size && seed < _to; seed++)
+			{
+				generate(seed, pattern, maze);
+				long dist = maze.calcDist(_limit);
+				if (dist <= _limit)
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_add(seed, dist);
+				}
+			}
+			bool do_save = false;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_in_work[t] = LONG_MAX;
+				std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+				if (checkpoint != 0 && std::chrono::duration<double>(now - _last_save).count() >= interval)
+				{
+					_last_save = now;
+					do_save = true;
+				}
+			}
+			if (do_save)
+				save(checkpoint);
+		}
+	}
+	// The first seed that is not yet searched: all seeds before it are
+	// done. Called with _mutex locked.
+	long _done()
+	{
+		long done = _next;
+		for (int t = 0; t < _nr_threads; t++)
+			if (_in_work[t] < done)
+				done = _in_work[t];
+		return done;
+	}
+	// Inserts the seed in the best k, ordered on dist and then on seed,
+	// such that the result does not depend on the order in which the
+	// seeds are searched. Seeds that are searched again after resuming
+	// are already present. Called with _mutex locked.
+	void _add(long seed, long dist)
+	{
+		int i = _nr_best;
+		for (int j = 0; j < _nr_best; j++)
+			if (_best[j].seed == seed)
+				return;
+		while (i > 0 && (_best[i-1].dist > dist || (_best[i-1].dist == dist && _best[i-1].seed > seed)))
+			i--;
+		if (i == _k)
+			return;
+		if (_nr_best < _k)
+			_nr_best++;
+		for (int j = _nr_best-1; j > i; j--)
+			_best[j] = _best[j-1];
+		_best[i].seed = seed;
+		_best[i].dist = dist;
+		if (_nr_best == _k)
+			_limit = _best[_k-1].dist;
+	}
+	std::mutex _mutex;
+	int _k;
+	int _nr_best;
+	Result *_best;
+	long _to;
+	long _next;
+	// The calcDist of the k-th best seed, above which seeds are skipped
+	std::atomic<long> _limit;
+	// The first seed of the block each thread works on, if any
+	long *_in_work;
+	int _nr_threads;
+	std::chrono::steady_clock::time_point _last_save;
+};
+
+// Searches the seeds from..to for the best k with SeedSearch, resuming
+// from and saving to the checkpoint file, and writes the maze of the
+// best seed to Maze.svg
+void seedSearch(const char *checkpoint, long from, long to, int k, int nr_threads = 0)
+{
+	SeedSearch search(k, from, to);
+	if (search.load(checkpoint))
+		fprintf(stderr, "Resuming from seed %ld\n", search.next());
+	search.run(nr_threads, checkpoint);
+	for (int i = 0; i < search.nrBest(); i++)
+		printf("%ld %ld\n", search.best(i).seed, search.best(i).dist);
+	if (search.nrBest() > 0)
+	{
+		Maze pattern(6, 6);
+		Maze maze(30, 30);
+		SeedSearch::generate(search.best(0).seed, pattern, maze);
+		maze.svg("Maze.svg", 2, 8, "red", 1, true);
+	}
+}
+
+bool test_all()
+{
+	bool result = true;
+	uint64_t seed = time(0);
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateRecursive();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateSplit();
+		if (!maze.check()) { fprintf(stderr, "Error: generateSplit failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateSplit failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze serial(150, 120, seed);
+		Maze parallel(150, 120, seed++);
+		serial.generateSplit(1);
+		parallel.generateSplit(4);
+		bool same = true;
+		for (int i = 0; i < 150; i++)
+			for (int j = 0; j < 120; j++)
+				if (   (i < 149 && serial.right(i, j) != parallel.right(i, j))
+				    || (j < 119 && serial.bottom(i, j) != parallel.bottom(i, j)))
+					same = false;
+		if (!same || !parallel.check()) { fprintf(stderr, "Error: parallel generateSplit differs\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateTrees();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateDig();
+		if (!maze.check()) { fprintf(stderr, "Error: generateDig failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateDig failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateFractal(Maze::frac_regular);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_regular) failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateFractal(Maze::frac_reverse_random_orient_no_cross);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_reverse_random_orient_no_cross) failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateFractal(Maze::frac_random_orient_no_cross);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_random_orient_no_cross) failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateFractal(Maze::frac_random_orient);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_random_orient) failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateFractal(Maze::frac_all_random);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_all_random) failed\n"); result = false; }
+	}
+	{
+		Maze maze(2, 17, seed++);
+		maze.generateFractal(Maze::frac_regular);
+		if (!maze.check()) { fprintf(stderr, "Error: generateFractal(frac_regular) failed on 2x17\n"); result = false; }
+	}
+	{
+		Maze serial(150, 90, seed);
+		Maze parallel(150, 90, seed++);
+		serial.generateFractal(Maze::frac_all_random, 1);
+		parallel.generateFractal(Maze::frac_all_random, 4);
+		bool same = true;
+		for (int i = 0; i < 150; i++)
+			for (int j = 0; j < 90; j++)
+				if (   (i < 149 && serial.right(i, j) != parallel.right(i, j))
+				    || (j < 89 && serial.bottom(i, j) != parallel.bottom(i, j)))
+					same = false;
+		if (!same || !parallel.check()) { fprintf(stderr, "Error: parallel generateFractal differs\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateRandom();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRandom failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRandom failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateKruskal();
+		if (!maze.check()) { fprintf(stderr, "Error: generateKruskal failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateKruskal failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateWilson();
+		if (!maze.check()) { fprintf(stderr, "Error: generateWilson failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateWilson failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateRecursive();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive with stampStreched failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRecursive with stampStreched failed after removing crosses\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateRandom();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRandom with stampStreched failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateRandom with stampStreched failed after removing crosses\n"); return false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateWilson();
+		if (!maze.check()) { fprintf(stderr, "Error: generateWilson with stampStreched failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateWilson with stampStreched failed after removing crosses\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateTrees();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed after removing crosses\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateKruskal();
+		if (!maze.check()) { fprintf(stderr, "Error: generateKruskal with stampStreched failed\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateDig();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTrees with stampStreched failed after removing crosses\n"); result = false; }
+	}
+	{
+		Maze maze(20, 20, seed++);
+		maze.generateWilson();
+		int flips = maze.generateDig();
+		if (flips != 0 || !maze.check()) { fprintf(stderr, "Error: generateDig changed %d traversals of a tree\n", flips); result = false; }
+		Maze maze2(20, 20, seed++);
+		flips = maze2.generateTrees();
+		if (flips <= 0 || !maze2.check()) { fprintf(stderr, "Error: generateTrees reported %d changed traversals\n", flips); result = false; }
+	}
+	{
+		Maze maze(5, 5, seed++);
+		maze.generateRecursive();
+		Maze maze2(15, 15, seed++);
+		maze2.stampAt(maze, 5, 5);
+		maze2.generateWilson();
+		if (!maze2.check()) { fprintf(stderr, "Error: generateWilson with stampAt failed\n"); result = false; }
+	}
+	{
+		Maze core(5, 4, seed++);
+		core.generateWilson();
+		Maze maze(15, 14, seed++);
+		maze.stampAt(core, 6, 2);
+		maze.generateWilsonAround(6, 2, 5, 4);
+		if (!maze.check()) { fprintf(stderr, "Error: generateWilsonAround failed\n"); result = false; }
+		Maze layers(37, 33, seed++);
+		layers.stampAt(core, 16, 3);
+		bool ok = !layers.generateLayers(16, 3, 5, 4, 0) && layers.generateLayers(16, 3, 5, 4, 5);
+		ok = ok && layers.check();
+		// Each layer is a maze by itself, the second one at (6, 0)
+		Maze layer(25, 17);
+		for (int i = 0; i < 25; i++)
+			for (int j = 0; j < 17; j++)
+			{
+				if (i < 24)
+					layer.right(i, j) = layers.right(i + 6, j) == s_passage ? s_passage : s_wall;
+				if (j < 16)
+					layer.bottom(i, j) = layers.bottom(i + 6, j) == s_passage ? s_passage : s_wall;
+			}
+		ok = ok && layer.check();
+		if (!ok) { fprintf(stderr, "Error: generateLayers failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 30, seed++);
+		maze.generateTiled(8, 7, Maze::alg_wilson, 3);
+		if (!maze.check()) { fprintf(stderr, "Error: generateTiled(alg_wilson) failed\n"); result = false; }
+		maze.removeCrosses();
+		if (!maze.check()) { fprintf(stderr, "Error: generateTiled(alg_wilson) failed after remove crosses\n"); result = false; }
+	}
+	{
+		Maze maze2(6, 6, seed++);
+		maze2.generateRecursive();
+		Maze maze(30, 30, seed++);
+		maze.stampStreched(maze2);
+		maze.generateTiled(10, 10, Maze::alg_recursive, 2);
+		if (!maze.check()) { fprintf(stderr, "Error: generateTiled(alg_recursive) with stampStreched failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 20);
+		EllerGenerator eller(30, 20, seed++);
+		MazeRows rows(maze);
+		eller.generate(rows);
+		if (!maze.check()) { fprintf(stderr, "Error: EllerGenerator failed\n"); result = false; }
+	}
+	{
+		Maze maze(30, 20, seed++);
+		maze.generateRecursive();
+		long dist[30*20];
+		maze.calcDistances(dist);
+		long pairs = 0;
+		double sum = 0;
+		for (int l = 0; l < 30*20; l++)
+		{
+			pairs += dist[l];
+			sum += dist[l] * (double)l;
+		}
+		if (pairs != 30*20*(30*20-1)/2 || fabs(sum/pairs - maze.averageDist()) > 1e-9) { fprintf(stderr, "Error: calcDistances does not match averageDist\n"); result = false; }
+	}
+	{
+		// In a path the convolutions reach one past the longest distance
+		Maze maze(200, 1, seed++);
+		maze.generateRecursive();
+		long *dist = new long[200];
+		maze.calcDistances(dist);
+		bool ok = dist[0] == 0;
+		for (int l = 1; l < 200; l++)
+			ok = ok && dist[l] == 200 - l;
+		delete[] dist;
+		// Rooms cut off by a hard wall are not counted
+		Maze split(6, 1);
+		for (int i = 0; i < 5; i++)
+			split.right(i, 0) = i == 2 ? s_hard_wall : s_passage;
+		ok = ok && fabs(split.averageDist() - 4/3.0) < 1e-9;
+		if (!ok) { fprintf(stderr, "Error: calcDistances or averageDist of a path failed\n"); result = false; }
+	}
+	{
+		// Counts whose square sums are far beyond the precision of doubles
+		// are still convolved exactly
+		const int n = 1000;
+		long *a = new long[n];
+		long *conv = new long[2*n-1];
+		for (int x = 0; x < n; x++)
+			a[x] = (1L << 20) + 7919L*x % 1000;
+		Maze::selfConvolve(a, n, conv);
+		bool ok = true;
+		for (int l = 0; l < 2*n-1 && ok; l++)
+		{
+			long direct = 0;
+			for (int x = l < n ? 0 : l - n + 1; x <= l && x < n; x++)
+				direct += a[x] * a[l - x];
+			ok = conv[l] == direct;
+		}
+		delete[] a;
+		delete[] conv;
+		if (!ok) { fprintf(stderr, "Error: selfConvolve of large counts failed\n"); result = false; }
+	}
+	{
+		Maze maze(23, 17, seed++);
+		for (int j = 0; j < 10; j++)
+			maze.right(11, j) = s_hard_wall;
+		maze.generateWilson();
+		MazeFile file;
+		if (!maze.save("MazeTest.maze") || !file.open("MazeTest.maze"))
+			result = false;
+		else
+		{
+			Maze &loaded = file.maze();
+			bool same = file.header().w == 23 && file.header().h == 17 && file.header().seed == seed-1 && file.header().algorithm == Maze::alg_wilson;
+			for (int i = 0; i < 23; i++)
+				for (int j = 0; j < 17; j++)
+				{
+					if (i < 22 && loaded.right(i, j) != maze.right(i, j))
+						same = false;
+					if (j < 16 && loaded.bottom(i, j) != maze.bottom(i, j))
+						same = false;
+				}
+			if (!same || !loaded.check()) { fprintf(stderr, "Error: MazeFile does not match saved maze\n"); result = false; }
+		}
+		file.close();
+		remove("MazeTest.maze");
+	}
+	{
+		Maze maze(40, 30, seed++);
+		maze.generateWilson();
+		int height[40*30];
+		maze.calcHeights(height);
+		Maze part1(40, 30);
+		Maze part2(40, 30);
+		part1.fillPartial(maze, 0.4);
+		part2.fillPartial(maze, 0.4, height);
+		bool same = true;
+		for (int i = 0; i < 40; i++)
+			for (int j = 0; j < 30; j++)
+				if (   (i < 39 && part1.right(i, j) != part2.right(i, j))
+				    || (j < 29 && part1.bottom(i, j) != part2.bottom(i, j)))
+					same = false;
+		if (!same) { fprintf(stderr, "Error: fillPartial with given heights differs\n"); result = false; }
+	}
+	{
+		Maze maze(30, 20, seed++);
+		maze.generateWilson();
+		Maze::path_index index(maze);
+		int path[30*20];
+		bool *seen = new bool[30*20];
+		for (int r = 0; r < 30*20; r++)
+			seen[r] = false;
+		for (int a = 0; a < 30*20; a += 37)
+			for (int b = 0; b < 30*20; b++)
+			{
+				// In a tree, a path without repeated rooms is the shortest
+				int len = index.path(a, b, path);
+				bool ok = len == index.distance(a, b) + 1 && path[0] == a && path[len-1] == b;
+				for (int q = 0; q < len && ok; q++)
+				{
+					ok = !seen[path[q]];
+					seen[path[q]] = true;
+					if (q > 0)
+					{
+						int p = path[q-1] < path[q] ? path[q-1] : path[q];
+						int d = path[q-1] < path[q] ? path[q] - path[q-1] : path[q-1] - path[q];
+						ok = ok && (d == 1 ? p % 30 < 29 && maze.right(p % 30, p / 30) == s_passage
+						                   : d == 30 && maze.bottom(p % 30, p / 30) == s_passage);
+					}
+				}
+				for (int q = 0; q < len; q++)
+					seen[path[q]] = false;
+				if (!ok)
+				{
+					fprintf(stderr, "Error: path_index gives wrong path from %d to %d\n", a, b);
+					result = false;
+				}
+			}
+		delete[] seen;
+	}
+	{
+		Maze fresh(25, 15, seed);
+		fresh.generateWilson();
+		Maze reused(40, 30, 0);
+		reused.generateRecursive();
+		reused.reset(25, 15, seed++);
+		reused.generateWilson();
+		Maze moved(std::move(reused));
+		bool same = true;
+		for (int i = 0; i < 25; i++)
+			for (int j = 0; j < 15; j++)
+				if (   (i < 24 && fresh.right(i, j) != moved.right(i, j))
+				    || (j < 14 && fresh.bottom(i, j) != moved.bottom(i, j)))
+					same = false;
+		if (!same || !moved.check()) { fprintf(stderr, "Error: reset or moved maze differs\n"); result = false; }
+	}
+	{
+		Maze row(37, 21, seed);
+		MazeT<PackedPlane, Xoshiro256, MortonLayout> morton(37, 21, seed++);
+		row.generateRecursive();
+		morton.generateRecursive();
+		row.removeCrosses();
+		morton.removeCrosses();
+		bool same = true;
+		for (int i = 0; i < 37; i++)
+			for (int j = 0; j < 21; j++)
+				if (   (i < 36 && row.right(i, j) != morton.right(i, j))
+				    || (j < 20 && row.bottom(i, j) != morton.bottom(i, j)))
+					same = false;
+		if (!same || !morton.check()) { fprintf(stderr, "Error: maze with MortonLayout differs\n"); result = false; }
+	}
+	{
+		// The types of the rooms are counted a row at a time with the
+		// row layout, and room by room otherwise
+		Maze row(70, 45, seed);
+		MazeT<PackedPlane, Xoshiro256, MortonLayout> morton(70, 45, seed++);
+		row.generateWilson();
+		morton.generateWilson();
+		if (row.right(3, 4) == s_wall)
+		{
+			row.right(3, 4) = s_hard_wall;
+			morton.right(3, 4) = s_hard_wall;
+		}
+		Stat row_stats[22];
+		Stat morton_stats[22];
+		row.calcStats(row_stats);
+		morton.calcStats(morton_stats);
+		bool same = true;
+		for (int i = 0; i < 22; i++)
+			if (row_stats[i].avg() != morton_stats[i].avg())
+				same = false;
+		if (!same) { fprintf(stderr, "Error: calcStats differs between layouts\n"); result = false; }
+	}
+	{
+		// Searching the seeds 1..40 in two steps, resuming from the saved
+		// progress, gives the best seeds of a sequential search
+		SeedSearch first(3, 1, 20);
+		first.run(2, "SeedSearchTest.txt");
+		SeedSearch search(3, 1, 40);
+		bool ok = search.load("SeedSearchTest.txt") && search.next() == 20;
+		remove("SeedSearchTest.txt");
+		search.run(3);
+		long dist[40];
+		for (int i = 1; i < 40; i++)
+		{
+			Maze pattern(6, 6, i);
+			pattern.generateRecursive();
+			Maze maze(30, 30, i);
+			maze.stampStreched(pattern);
+			maze.generateWilson();
+			dist[i] = maze.calcDist(LONG_MAX);
+		}
+		ok = ok && search.nrBest() == 3;
+		for (int b = 0; b < search.nrBest() && ok; b++)
+		{
+			// The number of seeds that are better than the b-th best
+			int better = 0;
+			for (int i = 1; i < 40; i++)
+				if (dist[i] < search.best(b).dist || (dist[i] == search.best(b).dist && i < search.best(b).seed))
+					better++;
+			ok = better == b && dist[search.best(b).seed] == search.best(b).dist;
+		}
+		if (!ok) { fprintf(stderr, "Error: SeedSearch failed\n"); result = false; }
+	}
+	{
+		MazeBatch batch(13, 9, seed++);
+		batch.generate();
+		Stat batch_stats[22];
+		batch.calcStats(batch_stats);
+		Stat stats[22];
+		bool ok = true;
+		for (int m = 0; m < MazeBatch::nr_mazes; m++)
+		{
+			Maze maze(13, 9);
+			batch.copyTo(m, maze);
+			ok = ok && maze.check();
+			maze.calcStats(stats);
+		}
+		for (int i = 0; i < 22; i++)
+			if (fabs(stats[i].avg() - batch_stats[i].avg()) > 1e-9)
+				ok = false;
+		if (!ok) { fprintf(stderr, "Error: MazeBatch failed\n"); result = false; }
+	}
+#ifdef MAZE_STATS
+	{
+		Maze maze(20, 20, seed++);
+		maze.generateWilson();
+		MazeCounters &c = maze.counters();
+		if (c.wilson_walk_steps - c.wilson_erased != 20*20-1) { fprintf(stderr, "Error: Wilson counters incorrect\n"); result = false; }
+		maze.check();
+		if (c.iterator_steps == 0) { fprintf(stderr, "Error: iterator counter incorrect\n"); result = false; }
+	}
+#endif
+
+	return result;
+}
+
+// The accumulators for a block of iterations of statistics(). The
+// iterations are divided into blocks of a fixed size, which are merged
+// in order, such that the result does not depend on the number of
+// threads that are used.
+class StatBlock
+{
+public:
+	Stat stats[22];
+	Stat times;
+	void merge(const StatBlock &block)
+	{
+		for (int i = 0; i < 22; i++)
+			stats[i].merge(block.stats[i]);
+		times.merge(block.times);
+	}
+};
+
+// Reuses maze and maze2 for each run, such that after the first runs
+// no heap allocation is done
+void statisticsRun(int t, int size, uint64_t seed, StatBlock &block, Maze &maze, Maze &maze2)
+{
+	maze.reset(seed);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	switch(t)
+	{
+		case 0:
+			maze.generateWilson(); break;
+		case 1:
+			maze.generateRandom(); break;
+		case 2:
+			maze.generateDig(); break;
+		case 3:
+			maze.generateSplit(); break;
+		case 4:
+			maze.generateTrees(); break;
+		case 5:
+			maze.generateRecursive(); break;
+		case 6:
+		{
+			maze2.reset(~seed);
+			maze2.generateRecursive();
+			maze.stampStreched(maze2);
+			maze.generateDig();
+		} break;
+		case 7:
+			maze.generateFractal(Maze::frac_reverse_random_orient_no_cross); break;
+		case 8:
+			maze.generateFractal(Maze::frac_random_orient_no_cross); break;
+		case 9:
+			maze.generateFractal(Maze::frac_random_orient); break;
+		case 10:
+			maze.generateFractal(Maze::frac_all_random); break;
+	}
+	if (!maze.check())
+		printf("Error\n");
+	double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	block.times.add(us/((double)size * size));
+	maze.calcStats(block.stats);
+}
+
+void statisticsWorker(int t, int size, uint64_t seed, StatBlock *blocks, int nr_blocks, int block_size, std::atomic<int> *next)
+{
+	Maze maze(size, size);
+	Maze maze2(size/5, size/5);
+	maze2.useWorkspace(&maze.workspace());
+	for (int b = (*next)++; b < nr_blocks; b = (*next)++)
+		for (int i = b*block_size; i < (b+1)*block_size; i++)
+			statisticsRun(t, size, seed + 1000*t + i, blocks[b], maze, maze2);
+}
+
+void statistics(uint64_t seed = 1, int nr_threads = 0)
+{
+	if (nr_threads <= 0)
+		nr_threads = std::thread::hardware_concurrency();
+	if (nr_threads <= 0)
+		nr_threads = 1;
+	const int nr_blocks = 25;
+	const int block_size = 20;
+	const char *names[] = { "Wil", "Ran", "Dig", "Spl", "Tre", "Rec", "", "", "", "", "" };
+	for (int t = 0; t < 6; t++)
+	{
+		printf("%s ", names[t]);
+		for (int size = 20; size <= 20; size += 10)
+		{
+			StatBlock blocks[nr_blocks];
+			std::atomic<int> next(0);
+			std::thread *workers = new std::thread[nr_threads-1];
+			for (int w = 0; w < nr_threads-1; w++)
+				workers[w] = std::thread(statisticsWorker, t, size, seed, blocks, nr_blocks, block_size, &next);
+			statisticsWorker(t, size, seed, blocks, nr_blocks, block_size, &next);
+			for (int w = 0; w < nr_threads-1; w++)
+				workers[w].join();
+			delete[] workers;
+			StatBlock all;
+			for (int b = 0; b < nr_blocks; b++)
+				all.merge(blocks[b]);
+			Stat (&stats)[22] = all.stats;
+			Stat &times = all.times;
+			//printf("%d: ", size);
+			for (int i = 16; i < 21; i++)
+			{
+				printf(" %5.2lf(%5.2lf)", 100*stats[i].avg(), 100*stats[i].stddev());
+			}
+			printf(" %6.2lf(%5.2lf) #", stats[21].avg(), stats[21].stddev());
+			int ones[4] = { 1, 2, 4, 8 };
+			dist_kind(stats, ones, 4, "ones");
+			int two_corners[4] = { 1+2, 2+4, 4+8, 8+1 };
+			dist_kind(stats, two_corners, 4, "two corners");
+			int two_straight[2] = { 1+4, 2+8 };
+			dist_kind(stats, two_straight, 2, "two straight");
+			int three[4] = { 1+2+4, 2+4+8, 4+8+1, 8+1+2 };
+			dist_kind(stats, three, 4, "three");
+			printf(" %6.2lf(%5.2lf)", times.avg(), times.stddev());
+			printf("\n");
+			//for (int i = 0; i < 4; i++)
+			//	printf(" %5.2lf(%5.2lf)\n", 100*stats[ones[i]].avg(), 100*stats[ones[i]].stddev());
+			//double max_dist = 0;
+			//double sum_dist = 0;
+			//for (int i = 0; i < 3; i++)
+			//	for (int j = i+1; j < 4; j++)
+			//	{
+			//		double dist = Stat::dist(stats[ones[i]], stats[ones[j]]);
+			//		if (dist > max_dist)
+			//			max_dist = dist;
+			//		sum_dist += dist;
+			//	}
+			//printf("ones dist = %lf %lf\n", max_dist, sum_dist);
+		}
+	}
+}
+template <class Plane>
+void timeLayout(const char *name, int size)
+{
+	const int n = 5;
+	double t_rec = 0, t_spl = 0, t_fra = 0, t_wil = 0, t_chk = 0;
+	long bytes = 0;
+	for (int k = 0; k < n; k++)
+	{
+		{
+			MazeT<Plane> maze(size, size, k);
+			bytes = maze.bytes();
+			long start = clock();
+			maze.generateRecursive();
+			t_rec += clock() - start;
+			start = clock();
+			if (!maze.check())
+				printf("Error\n");
+			t_chk += clock() - start;
+		}
+		{
+			MazeT<Plane> maze(size, size, k);
+			long start = clock();
+			maze.generateSplit();
+			t_spl += clock() - start;
+		}
+		{
+			MazeT<Plane> maze(size, size, k);
+			long start = clock();
+			maze.generateFractal(MazeT<Plane>::frac_all_random);
+			t_fra += clock() - start;
+		}
+		{
+			MazeT<Plane> maze(size/4, size/4, k);
+			long start = clock();
+			maze.generateWilson();
+			t_wil += clock() - start;
+		}
+	}
+	double cells = (double)n * size * size * CLOCKS_PER_SEC / 1e9;
+	printf("%s: %ld bytes rec %.1lf spl %.1lf fra %.1lf wil %.1lf chk %.1lf ns/cell\n", name, bytes,
+		   t_rec/cells, t_spl/cells, t_fra/cells, t_wil/(cells/16), t_chk/cells);
+}
+
+void compareLayouts()
+{
+	timeLayout<StatePlane>("state ", 300);
+	timeLayout<PackedPlane>("packed", 300);
+}
+
+void benchmarkWilson()
+{
+	int sizes[] = { 100, 200, 500, 1000, 2000 };
+	for (int k = 0; k < 5; k++)
+	{
+		int size = sizes[k];
+		Maze maze(size, size);
+		long start = clock();
+		maze.generateWilson();
+		double t = (clock() - start)/(double)CLOCKS_PER_SEC;
+		printf("Wilson %4dx%-4d %8.3lf s %6.1lf ns/cell\n", size, size, t, t*1e9/((double)size * size));
+	}
+}
+
+// Counts the allocations made with new, such that the benchmarks can
+// report them. As this costs an atomic increment for each allocation
+// in every mode, it is only done when compiled with MAZE_COUNT_ALLOCS
+// defined.
+static std::atomic<long> nr_allocations(0);
+
+#ifdef MAZE_COUNT_ALLOCS
+static void *countedAlloc(size_t size, bool nothrow = false)
+{
+	nr_allocations++;
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == 0 && !nothrow)
+		throw std::bad_alloc();
+	return p;
+}
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size, true); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size, true); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+#ifdef __cpp_aligned_new
+static void *countedAlignedAlloc(size_t size, std::align_val_t align, bool nothrow = false)
+{
+	nr_allocations++;
+	size_t a = (size_t)align;
+	void *p = aligned_alloc(a, (size + a - 1) / a * a);
+	if (p == 0 && !nothrow)
+		throw std::bad_alloc();
+	return p;
+}
+void *operator new(size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void *operator new[](size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return countedAlignedAlloc(size, align, true); }
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return countedAlignedAlloc(size, align, true); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { free(p); }
+#endif
+#endif
+
+// Writes the average number of allocations per run for the JSON output
+// of the benchmarks, which is null when they are not counted
+const char *benchAllocations(char *buf, size_t len, long allocations, int runs)
+{
+#ifdef MAZE_COUNT_ALLOCS
+	snprintf(buf, len, "%.1lf", allocations/(double)runs);
+#else
+	(void)allocations;
+	(void)runs;
+	snprintf(buf, len, "null");
+#endif
+	return buf;
+}
+
+// Resets the peak resident set size to the current one (Linux only)
+void resetPeakRss()
+{
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+	if (f != 0)
+	{
+		fputs("5", f);
+		fclose(f);
+	}
+}
+
+// Returns the peak resident set size in kB
+long peakRss()
+{
+	long kb = 0;
+	FILE *f = fopen("/proc/self/status", "r");
+	if (f != 0)
+	{
+		char line[200];
+		while (fgets(line, sizeof(line), f) != 0)
+			if (sscanf(line, "VmHWM: %ld", &kb) == 1)
+				break;
+		fclose(f);
+	}
+	if (kb == 0)
+	{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		kb = usage.ru_maxrss;
+	}
+	return kb;
+}
+
+// The operations that benchmark() times. The first ones are the
+// generators, in the order of Maze::algorithm. The other operations
+// are performed on a maze generated with Wilson's algorithm.
+enum bench_op { bench_remove_crosses = Maze::alg_kruskal + 1, bench_check, bench_calc_stats, bench_fill_partial, bench_svg, bench_nr_ops };
+
+const char *bench_names[bench_nr_ops] =
+{
+	"generateRecursive", "generateSplit", "generateTrees", "generateDig", "generateWilson", "generateRandom",
+	"generateFractal(frac_regular)", "generateFractal(frac_reverse)", "generateFractal(frac_random_orient_no_cross)",
+	"generateFractal(frac_reverse_random_orient_no_cross)", "generateFractal(frac_random_orient)", "generateFractal(frac_all_random)",
+	"generateKruskal", "removeCrosses", "check", "calcStats", "fillPartial", "svg"
+};
+
+// Receives the results of the timed operations, such that the compiler
+// cannot leave out operations that have no other effect
+volatile double bench_sink;
+
+// The largest size for which each operation is timed, for those that
+// do not scale well
+int bench_max_size[bench_nr_ops] =
+{
+	4096, 4096, 4096, 4096, 4096, 4096,
+	4096, 4096, 4096, 4096, 4096, 4096,
+	4096, 2048, 4096, 4096, 4096, 1024
+};
+
+// The operations that are also timed with the MortonLayout, which are
+// those that walk through the maze
+int bench_layout_ops[] = { Maze::alg_recursive, Maze::alg_wilson, Maze::alg_kruskal, bench_check };
+
+// Times an operation on a maze of size by size, repeating it (on
+// different mazes) until min_time seconds have passed, and writes the
+// average time per cell, the average number of allocations and the
+// peak resident set size as a JSON object.
+template <class M>
+void benchmarkOp(FILE *f, int op, int size, double min_time, bool first)
+{
+	double total = 0;
+	long allocations = 0;
+	int runs = 0;
+	resetPeakRss();
+	// The mazes are reused, such that the allocations after the first
+	// run are those of the operation itself
+	M maze(size, size);
+	M part(size, size);
+	while (runs == 0 || total < min_time)
+	{
+		maze.reset(runs + 1);
+		part.reset(runs + 1);
+		if (op >= bench_remove_crosses)
+			maze.generateWilson();
+		long allocations_before = nr_allocations;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		switch (op)
+		{
+			case bench_remove_crosses: maze.removeCrosses(); break;
+			case bench_check:          bench_sink = maze.check(); break;
+			case bench_calc_stats:
+			{
+				Stat stats[22];
+				maze.calcStats(stats);
+				bench_sink = stats[21].avg();
+				break;
+			}
+			case bench_fill_partial:   part.fillPartial(maze, 0.5); break;
+			case bench_svg:            maze.svg("MazeBench.svg", 2, 8, "red", 1, true); break;
+			default:                   maze.generate((typename M::algorithm)op); break;
+		}
+		total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		allocations += nr_allocations - allocations_before;
+		runs++;
+	}
+	if (op == bench_svg)
+		remove("MazeBench.svg");
+	char buf[30];
+	fprintf(f, "%s\n    { \"name\": \"%s\", \"layout\": \"%s\", \"w\": %d, \"h\": %d, \"runs\": %d, \"ns_per_cell\": %.2lf, \"allocations\": %s, \"peak_rss_kb\": %ld }",
+		first ? "" : ",", bench_names[op], M::layoutName(), size, size, runs, total*1e9/((double)runs*size*size), benchAllocations(buf, sizeof(buf), allocations, runs), peakRss());
+	fflush(f);
+}
+
+// Times generating a batch of mazes with MazeBatch and calculating their
+// statistics, and writes the average time per cell of each maze as
+// the benchmarks of benchmarkOp. It is to be compared with the sum of
+// those of generateWilson and calcStats.
+void benchmarkBatch(FILE *f, int size, double min_time, bool first)
+{
+	double total = 0;
+	long allocations = 0;
+	int runs = 0;
+	resetPeakRss();
+	MazeBatch batch(size, size);
+	while (runs == 0 || total < min_time)
+	{
+		batch.seed(runs + 1);
+		long allocations_before = nr_allocations;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Stat stats[22];
+		batch.generate();
+		batch.calcStats(stats);
+		bench_sink = stats[21].avg();
+		total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		allocations += nr_allocations - allocations_before;
+		runs++;
+	}
+	int mazes = runs * MazeBatch::nr_mazes;
+	char buf[30];
+	fprintf(f, "%s\n    { \"name\": \"MazeBatch(generate+calcStats)\", \"layout\": \"row\", \"w\": %d, \"h\": %d, \"runs\": %d, \"ns_per_cell\": %.2lf, \"allocations\": %s, \"peak_rss_kb\": %ld }",
+		first ? "" : ",", size, size, mazes, total*1e9/((double)mazes*size*size), benchAllocations(buf, sizeof(buf), allocations, mazes), peakRss());
+	fflush(f);
+}
+
+// Times all operations for sizes from 10x10 up to max_size x max_size
+// and writes the results as JSON to the given file
+void benchmark(const char *filename, int max_size)
+{
+	FILE *f = fopen(filename, "wt");
+	if (f == 0)
+	{
+		fprintf(stderr, "Cannot open file '%s' for writing\n", filename);
+		return;
+	}
+	int sizes[] = { 10, 32, 100, 316, 1000, 2048, 4096 };
+	fprintf(f, "{ \"benchmarks\": [");
+	bool first = true;
+	for (int op = 0; op < bench_nr_ops; op++)
+		for (int k = 0; k < 7; k++)
+			if (sizes[k] <= max_size && sizes[k] <= bench_max_size[op])
+			{
+				fprintf(stderr, "%s %dx%d\n", bench_names[op], sizes[k], sizes[k]);
+				benchmarkOp<Maze>(f, op, sizes[k], 0.2, first);
+				first = false;
+			}
+	for (int l = 0; l < 4; l++)
+		for (int k = 0; k < 7; k++)
+			if (sizes[k] <= max_size)
+			{
+				int op = bench_layout_ops[l];
+				fprintf(stderr, "%s %dx%d morton\n", bench_names[op], sizes[k], sizes[k]);
+				benchmarkOp<MazeT<PackedPlane, Xoshiro256, MortonLayout> >(f, op, sizes[k], 0.2, first);
+				first = false;
+			}
+	// MazeBatch is meant for many small mazes
+	for (int k = 0; k < 3; k++)
+		if (sizes[k] <= max_size)
+		{
+			fprintf(stderr, "MazeBatch %dx%d\n", sizes[k], sizes[k]);
+			benchmarkBatch(f, sizes[k], 0.2, first);
+			first = false;
+		}
+	fprintf(f, "\n] }\n");
+	fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	if (!test_all())
+	{
+		fprintf(stderr, "Error: Some test failed\n");
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "bench") == 0)
+	{
+		benchmark(argc > 2 ? argv[2] : "bench.json", argc > 3 ? atoi(argv[3]) : 4096);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "search") == 0)
+	{
+		seedSearch(argc > 2 ? argv[2] : "seeds.txt", argc > 3 ? atol(argv[3]) : 1, argc > 4 ? atol(argv[4]) : 1000000, argc > 5 ? atoi(argv[5]) : 10);
+		return 0;
+	}
+	uint64_t seed = time(0);
+	//statistics(seed);
+	//compareLayouts();
+	//benchmarkWilson();
+	//Maze maze(30, 30);
+	//maze.generateRecursive();
+	//maze.removeCrosses();
+	//maze.generateSplit();
+	//maze.generateFractal(Maze::frac_regular);
+	//maze.generateFractal(Maze::frac_reverse_random_orient_no_cross);
+	//maze.generateFractal(Maze::frac_random_orient_no_cross);
+	//maze.generateFractal(Maze::frac_random_orient);
+	//maze.generateFractal(Maze::frac_all_random);
+	//Maze maze2(6, 6);
+	//maze2.generateRecursive();
+	//maze.stampStreched(maze2);
+	//maze.generateDig();
+	//maze.generateRecursive();
+	//maze.generateTrees();
+	//maze.generateRandom();
+	//maze.print();
+	//maze.printStats();
+	//maze.printAverageDist();
+	//if (!maze.check())
+	//	printf("Incorrect\n");
+	//maze.svg("Maze.svg", 2, 8, "red", 1, true);
+	//maze.dump();
+	Maze maze(5, 5, seed++);
+	maze.generateWilson();
+	maze.print();
+	maze.svg("Maze4.svg", 4, 4, "red", 1, false);
+	Maze maze2(15, 15, seed++);
+	maze2.stampAt(maze, 5, 5);
+	maze2.print();
+	maze2.generateWilsonAround(5, 5, 5, 5);
+	maze2.print();
+	maze2.svg("Maze3.svg", 4, 4, "red", 1, false);
+	Maze maze3(25, 25, seed++);
+	maze3.stampAt(maze2, 5, 5);
+	maze3.generateWilsonAround(5, 5, 15, 15);
+	maze3.print();
+	maze3.svg("Maze2.svg", 4, 4, "red", 1, false);
+	Maze maze4(35, 35, seed++);
+	maze4.stampAt(maze3, 5, 5);
+	maze4.generateWilsonAround(5, 5, 25, 25);
+	maze4.print();
+	maze4.svg("Maze1.svg", 4, 4, "red", 1, true);
+/*	
+//*/
+/*
+	long min_dist;
+	int min_i = 0;
+	for (int i = 1; ; i++)
+	{
+		Maze maze2(6, 6, i);
+		maze2.generateRecursive();
+		Maze maze(30, 30, i);
+		maze.stampStreched(maze2);
+		maze.generateWilson();
+		long dist = maze.calcDist();
+		printf(" %ld\n", dist);
+		if (min_i == 0 || dist < min_dist)
+		{
+			min_dist = dist;
+			min_i = i;
+		}
+		if (i % 1000 == 0)
+		{
+			Maze maze2(6, 6, min_i);
+			maze2.generateRecursive();
+			Maze maze(30, 30, min_i);
+			maze.stampStreched(maze2);
+			maze.generateWilson();
+			printf("\nDist = %ld\n", maze.calcDist());
+			maze.svg("Maze.svg", 2, 8, "red", 1, true);
+			maze.svg("Maze2.svg", 5, 5, "red", 1, true);
+		}
+	}
+//*/
+}